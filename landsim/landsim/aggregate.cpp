@@ -0,0 +1,187 @@
+#include <map>
+#include "aggregate.h"
+#include "simulator.h"
+
+
+// Constructor of TAggregate: creates a population with no individuals in the landscape of the simulation
+// With positions, the home ranges of the individuals are drawn for the output
+
+TAggregate::TAggregate(TSimulator* simulatorIn, bool positions)
+{
+ simulator = simulatorIn;
+ landscape = simulator->GetLandscape();
+
+ // the seed is always drawn, so that the simulation is the same with and without the home ranges of the output
+ int seed = int(simulator->sto->BRandom());
+ sto = positions ? new StochasticLib1(seed) : NULL;
+
+ for (int c=0; c<landscape->NClasses(); c++)
+   {
+   // the fitness (energy yield) of the single cell home range multiplied by fecundity (b0 in the model)
+   // and normalized by the optimal home-range fitness (Phi in the model), as in TPopulation::Settle
+   double d = landscape->ClassFitness(c);
+   d *= simulator->GetBirthRate();
+   d /= simulator->GetOptimalFitness();
+   fitness.push_back(d);
+   nfree.push_back(landscape->ClassCells(c));
+   }
+ count.assign(1, vector<long>(nfree.size(), 0));
+ size = 0;
+}
+
+
+// Destructor of TAggregate
+
+TAggregate::~TAggregate()
+{
+ delete sto;
+}
+
+
+// Settle: settles n juveniles, each in a free cell of the best class with free cells (global dispersal)
+// The juveniles that find no free cell (floaters) die
+
+void TAggregate::Settle(long n)
+{
+ for (int c=0; c<int(nfree.size()) && n>0; c++)
+   {
+   long settlers = MIN(n, nfree[c]);
+   count[0][c] += settlers;
+   nfree[c] -= settlers;
+   size += settlers;
+   n -= settlers;
+   }
+}
+
+
+// Step: executes one step of the simulation with the numbers of individuals
+// The individuals breed and die as in TPopulation::ApplyBreedingAndMortality, group by group
+
+void TAggregate::Step()
+{
+ bool deterministic = (simulator->GetSurvival()>=1.0);
+ long juveniles = 0;
+
+ // a reproductive season has happened: every individual is one year older
+ count.insert(count.begin(), vector<long>(nfree.size(), 0));
+
+ for (unsigned int a=1; a<count.size(); a++)
+   for (int c=0; c<int(nfree.size()); c++)
+     {
+     long n = count[a][c];
+     if (n==0)
+       continue;
+
+     if (a >= simulator->GetBreedingAge())   // if age is greater than breeding age
+       {
+       if (deterministic)        // The number of offspring equals the fecundity
+         juveniles += n * iround(fitness[c]);
+       else                      // The sum of n Poisson with mean equal to fecundity
+         juveniles += simulator->sto->Poisson(n * fitness[c]);
+       }
+
+     long deaths;
+     if (deterministic)          // all die at the maximum age
+       deaths = (a < simulator->GetSurvival()) ? 0 : n;
+     else                        // each survives with probability simulator->GetSurvival()
+       deaths = n - simulator->sto->Binomial(int32_t(n), simulator->GetSurvival());
+     count[a][c] -= deaths;      // cells opened by adult mortality
+     nfree[c] += deaths;
+     size -= deaths;
+     }
+
+ // drops the oldest ages without individuals
+ while (count.size() > 1 && count.back() == vector<long>(nfree.size(), 0))
+   count.pop_back();
+
+ // juvenile mortality, then settlement of the survivors
+ if (!deterministic)
+   juveniles = simulator->sto->Binomial(int32_t(juveniles), simulator->GetSurvival());
+ Settle(juveniles);
+}
+
+
+// OutputHomeRanges: writes a list of the home ranges of each individual in a Mathematica format
+// The individuals are written in the order of OutputAges, from the oldest and by class within each age, so that the
+// k-th home range and the k-th age are those of the same individual, as in TPopulation. The cells of
+// each class are a random sample without replacement of its cells, in random order (partial Fisher-Yates shuffle).
+// The shuffle only keeps the numbers of the cells that were swapped, so drawing n cells takes a time of order n
+// whatever the size of the class. When the individuals are a large part of the class (an eighth or more) all the
+// numbers are kept in an array instead, which is faster; the cells drawn are the same. The cells drawn in the
+// background tiles of sparse storage are found from their numbers (see TLandscape::BackgroundCell).
+
+void TAggregate::OutputHomeRanges(ostream& os)
+{
+ occupied.clear();
+ next.resize(nfree.size());
+ for (int c=0; c<int(nfree.size()); c++)
+   {
+   next[c] = long(occupied.size());
+   long n = 0;   // individuals in the class
+   for (unsigned int a=0; a<count.size(); a++)
+     n += count[a][c];
+   if (n==0)
+     continue;
+
+   // the first n of a random permutation of the N cells of the class
+   long N = landscape->ClassCells(c);
+   bool dense = (n >= N/8);
+   if (dense)
+     {
+     sample.resize(N);
+     for (long j=0; j<N; j++)
+       sample[j] = j;
+     }
+   map<long,long> swapped;   // numbers of the swapped cells when they are not kept in sample
+   for (long j=0; j<n; j++)
+     {
+     long r = j + long(sto->Random() * (N-j));
+     long drawn;   // number of the cell drawn in the class
+     if (dense)
+       {
+       swap(sample[j], sample[r]);
+       drawn = sample[j];
+       }
+     else
+       {
+       map<long,long>::iterator sr = swapped.find(r);
+       map<long,long>::iterator sj = swapped.find(j);
+       drawn = (sr==swapped.end()) ? r : sr->second;
+       swapped[r] = (sj==swapped.end()) ? j : sj->second;
+       }
+     TCell cell;
+     if (!landscape->ClassCell(c, drawn, cell))   // the background cells are the last of the class
+       cell = landscape->BackgroundCell(drawn - (N - landscape->BackgroundCells()));
+     occupied.push_back(cell);
+     }
+   }
+
+ // the cells of each class are given to its individuals from the oldest
+ long k = 0;   // individuals written
+ for (int a=int(count.size())-1; a>=0; a--)
+   for (int c=0; c<int(nfree.size()); c++)
+     for (long i=0; i<count[a][c]; i++)
+       {
+       if (k>0)
+         os << ",\n";
+       os << '{' << occupied[next[c]++] << '}';
+       k++;
+       }
+}
+
+
+// OutputAges: writes a list of the individual ages in a Mathematica format, from the oldest
+
+void TAggregate::OutputAges(ostream& os)
+{
+ long k = 0;   // individuals written
+ for (int a=int(count.size())-1; a>=0; a--)
+   for (int c=0; c<int(nfree.size()); c++)
+     for (long i=0; i<count[a][c]; i++)
+       {
+       if (k>0)
+         os << ", ";
+       os << a;
+       k++;
+       }
+}
@@ -0,0 +1,51 @@
+#ifndef _AGGREGATE_H_
+#define _AGGREGATE_H_
+
+#include <vector>
+#include <ostream>
+#include "landscape.h"
+
+using namespace std;
+
+class TSimulator;
+class StochasticLib1;
+
+// TAggregate: the population as numbers of individuals of each age in each affinity class of the landscape
+// With global dispersal (dispersal mode 0) and home ranges of a single cell, the individuals of the same age in
+// the same class are exchangeable: their fitness is that of the class, they die and breed independently of
+// where they are, and a juvenile always settles in a random free cell of the best class with free cells.
+// Then the numbers of individuals are enough for the dynamics, and a step does not depend on the size of the
+// population or of the landscape:
+//   the deaths of a group are a binomial draw with the survival,
+//   the offspring of a group are a Poisson draw with the sum of their fecundities,
+//   the juveniles that survive are a binomial draw, and they fill the free cells of the classes from the best.
+// The cells of the individuals are not kept. The individuals of a class occupy a random set of its cells, so
+// the home ranges of the output are drawn at each step as a sample without replacement of the cells of each
+// class, with a random generator of their own.
+
+class TAggregate
+{
+ public:
+         TAggregate(TSimulator*, bool positions);
+         ~TAggregate();
+         long Size() const {return size;}
+         bool Positions() const {return sto!=NULL;}
+         void Settle(long njuveniles);
+         void Step();
+         void OutputHomeRanges(ostream&);
+         void OutputAges(ostream&);
+ private:
+         TSimulator* simulator;
+         TLandscape* landscape;
+         StochasticLib1* sto;          // random generator of the home ranges of the output, NULL without them
+         vector<double> fitness;       // expected number of offspring per breeding season of an individual of each class
+         vector<long> nfree;           // free cells of each class
+         vector<vector<long> > count;  // count[a][c]: number of individuals of age a in class c
+         long size;                    // number of individuals
+         vector<long> sample;          // numbers of the cells of a class, shuffled to draw the cells for the output when
+                                       // the individuals are a large part of the class
+         vector<TCell> occupied;       // cells drawn for the output, class by class
+         vector<long> next;            // place in occupied of the next cell of each class to be written
+};
+
+#endif
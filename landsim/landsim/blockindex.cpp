@@ -0,0 +1,197 @@
+#include <cstdlib>
+#include "blockindex.h"
+
+
+// Constructor of TBlockIndex: creates an empty index
+
+TBlockIndex::TBlockIndex() : raster(0), xmax(0), ymax(0), nbx(0), nby(0), sparse(false)
+{
+}
+
+
+// Build: divides the raster in blocks and calculates the summary of each block
+// The raster is not copied, the index keeps reading it and has to be told about every change with Occupy and Free
+// In sparse storage only the blocks of the stored tiles are scanned, the others keep the summary of the background
+
+void TBlockIndex::Build(const TRaster* land)
+{
+ raster = land;
+ xmax = land->nrows();
+ ymax = land->ncols();
+ nbx = (xmax + BLOCKSIZE - 1) / BLOCKSIZE;
+ nby = (ymax + BLOCKSIZE - 1) / BLOCKSIZE;
+ sparse = land->Sparse();
+ blocks.clear();
+ blockhash.Clear();
+ if (!sparse)
+   {
+   blocks.resize(long(nbx) * nby);
+   for (int bx=0; bx<nbx; bx++)
+     for (int by=0; by<nby; by++)
+       Scan(bx,by);
+   return;
+   }
+ for (int k=0; k<land->NTiles(); k++)
+   {
+   int x, y;
+   land->TileOrigin(k, x, y);
+   if (blockhash.Find(long(x/BLOCKSIZE)*nby + y/BLOCKSIZE) < 0)
+     {
+     Block(x/BLOCKSIZE, y/BLOCKSIZE);
+     Scan(x/BLOCKSIZE, y/BLOCKSIZE);
+     }
+   }
+}
+
+
+// Background: the summary of a block of background tiles of sparse storage, all its cells are free and have the
+// background affinity
+
+TBlockIndex::TBlock TBlockIndex::Background(int bx, int by) const
+{
+ double background = raster->BackgroundAffinity();
+ TBlock b;
+ b.maxaffty = (background < 0) ? -1 : background;
+ b.nmax = (background < 0) ? 0 : (MIN((bx+1)*BLOCKSIZE,xmax) - bx*BLOCKSIZE) * (MIN((by+1)*BLOCKSIZE,ymax) - by*BLOCKSIZE);
+ return b;
+}
+
+
+// Scan: recalculates the maximum affinity of the free cells of a block and how many cells have it
+
+void TBlockIndex::Scan(int bx, int by)
+{
+ TBlock& b = Block(bx,by);
+ b.maxaffty = -1;
+ b.nmax = 0;
+ for (int i=bx*BLOCKSIZE; i<MIN((bx+1)*BLOCKSIZE,xmax); i++)
+   for (int j=by*BLOCKSIZE; j<MIN((by+1)*BLOCKSIZE,ymax); j++)
+     {
+     double a = raster->FreeAffinity(i,j);
+     if (a < 0)                // occupied cell
+       continue;
+     if (a > b.maxaffty)
+       {
+       b.maxaffty = a;
+       b.nmax = 1;
+       }
+     else if (a == b.maxaffty)
+       b.nmax++;
+     }
+}
+
+
+// Occupy: updates the summary of the block of a cell that has just been occupied
+
+void TBlockIndex::Occupy(int x, int y, double affinity)
+{
+ if (affinity < 0)             // the cell was not free
+   return;
+ TBlock& b = Block(x/BLOCKSIZE, y/BLOCKSIZE);
+ if (affinity == b.maxaffty)
+   if (--b.nmax == 0)          // the last cell with the maximum affinity of the block was taken
+     Scan(x/BLOCKSIZE, y/BLOCKSIZE);
+}
+
+
+// Free: updates the summary of the block of a cell that has just been freed
+
+void TBlockIndex::Free(int x, int y, double affinity)
+{
+ if (affinity < 0)
+   return;
+ TBlock& b = Block(x/BLOCKSIZE, y/BLOCKSIZE);
+ if (affinity > b.maxaffty)
+   {
+   b.maxaffty = affinity;
+   b.nmax = 1;
+   }
+ else if (affinity == b.maxaffty)
+   b.nmax++;
+}
+
+
+// CountBlock: counts the free cells with the affinity of the query q in the part of a block inside the disk
+
+long TBlockIndex::CountBlock(int bx, int by, const TDiskQuery& q) const
+{
+ long rsq = long(q.qr)*q.qr;
+ long n = 0;
+ for (int i=MAX(bx*BLOCKSIZE,q.qx-q.qr); i<MIN(MIN((bx+1)*BLOCKSIZE,xmax),q.qx+q.qr+1); i++)
+   for (int j=MAX(by*BLOCKSIZE,q.qy-q.qr); j<MIN(MIN((by+1)*BLOCKSIZE,ymax),q.qy+q.qr+1); j++)
+     if (raster->FreeAffinity(i,j)==q.qaffty)
+       if (SQR(long(i-q.qx))+SQR(long(j-q.qy)) <= rsq)
+         n++;
+ return n;
+}
+
+
+// CountInDisk: counts the free cells with a given affinity inside the circle of radius r centered in (cx,cy)
+// Blocks without free cells of that affinity are skipped, blocks entirely inside the circle are counted from their summary
+// The query and the contributing blocks are remembered in q so that CellInDisk can pick one of the cells
+
+long TBlockIndex::CountInDisk(int cx, int cy, int r, double affinity, TDiskQuery& q) const
+{
+ q.qx = cx;
+ q.qy = cy;
+ q.qr = r;
+ q.qaffty = affinity;
+ q.visited.clear();
+
+ long rsq = long(r)*r;
+ long total = 0;
+ for (int bx=MAX(cx-r,0)/BLOCKSIZE; bx<=MIN(cx+r,xmax-1)/BLOCKSIZE; bx++)
+   for (int by=MAX(cy-r,0)/BLOCKSIZE; by<=MIN(cy+r,ymax-1)/BLOCKSIZE; by++)
+     {
+     TBlock b = Summary(bx,by);
+     if (b.maxaffty < affinity)         // no free cell of the block has the target affinity
+       continue;
+
+     // the block is inside the circle if its farthest cell from the center is
+     long dx = MAX(abs(bx*BLOCKSIZE-cx), abs(MIN((bx+1)*BLOCKSIZE,xmax)-1-cx));
+     long dy = MAX(abs(by*BLOCKSIZE-cy), abs(MIN((by+1)*BLOCKSIZE,ymax)-1-cy));
+     TBlockCount c;
+     c.bx = bx;
+     c.by = by;
+     c.inside = (SQR(dx)+SQR(dy) <= rsq);
+     if (c.inside && b.maxaffty == affinity)
+       c.count = b.nmax;
+     else c.count = CountBlock(bx,by,q);
+     if (c.count > 0)
+       {
+       q.visited.push_back(c);
+       total += c.count;
+       }
+     }
+ return total;
+}
+
+
+// CellInDisk: returns in (x,y) the k-th cell counted by the call to CountInDisk with the query q, k in [0,count-1]
+
+void TBlockIndex::CellInDisk(long k, int& x, int& y, const TDiskQuery& q) const
+{
+ int qx = q.qx;
+ int qy = q.qy;
+ int qr = q.qr;
+ double qaffty = q.qaffty;
+ long rsq = long(qr)*qr;
+ for (vector<TBlockCount>::const_iterator c=q.visited.begin(); c!=q.visited.end(); c++)
+   {
+   if (k >= c->count)            // the cell is in one of the next blocks
+     {
+     k -= c->count;
+     continue;
+     }
+   for (int i=MAX(c->bx*BLOCKSIZE,qx-qr); i<MIN(MIN((c->bx+1)*BLOCKSIZE,xmax),qx+qr+1); i++)
+     for (int j=MAX(c->by*BLOCKSIZE,qy-qr); j<MIN(MIN((c->by+1)*BLOCKSIZE,ymax),qy+qr+1); j++)
+       if (raster->FreeAffinity(i,j)==qaffty)
+         if (c->inside || SQR(long(i-qx))+SQR(long(j-qy)) <= rsq)
+           if (k-- == 0)
+             {
+             x = i;
+             y = j;
+             return;
+             }
+   }
+}
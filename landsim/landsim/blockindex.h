@@ -0,0 +1,96 @@
+#ifndef _BLOCKINDEX_H_
+#define _BLOCKINDEX_H_
+
+#include <vector>
+
+#include "raster.h"
+#include "tilehash.h"
+
+using namespace std;
+
+// TBlockIndex: summaries of the free cells of a raster in square blocks of BLOCKSIZE x BLOCKSIZE cells
+// Each block stores the maximum affinity of its free cells and how many free cells have that affinity,
+// which lets disk queries skip blocks without cells of the target affinity and count blocks inside the disk
+// without looking at their cells. Only the blocks crossed by the border of the disk are scanned cell by cell.
+// The queries do not change the index: a disk query is kept by the caller (see TDiskQuery), so that several
+// queries can run at the same time while the landscape does not change.
+// In sparse storage only the blocks with stored tiles are kept, found through a hash of the block numbers; the others
+// are all background and their summary is that of the background (see Summary). A block is added when its first tile
+// is stored.
+
+struct TBlockCount
+{
+   int bx;
+   int by;
+   long count;        // number of cells of the target affinity of the block inside the disk
+   bool inside;       // whether the block lies entirely inside the disk
+};
+
+// TDiskQuery: parameters of a disk query and the blocks that contributed to it
+
+struct TDiskQuery
+{
+   int qx, qy, qr;
+   double qaffty;
+   vector<TBlockCount> visited;
+   TDiskQuery() : qx(0), qy(0), qr(0), qaffty(-1) {}
+};
+
+class TBlockIndex
+{
+ public:
+   static const int BLOCKSIZE = 16;
+   TBlockIndex();
+   void Build(const TRaster* land);
+   void Occupy(int x, int y, double affinity);   // a free cell with the given affinity was occupied
+   void Free(int x, int y, double affinity);     // a cell with the given affinity was freed
+   long CountInDisk(int cx, int cy, int r, double affinity, TDiskQuery& q) const;
+   void CellInDisk(long k, int& x, int& y, const TDiskQuery& q) const;
+ private:
+   struct TBlock
+   {
+      double maxaffty;   // maximum affinity of the free cells in the block, -1 if the block is full
+      int nmax;          // number of free cells with maximum affinity
+   };
+   inline TBlock& Block(int bx, int by);
+   inline TBlock Summary(int bx, int by) const;
+   TBlock Background(int bx, int by) const;
+   void Scan(int bx, int by);
+   long CountBlock(int bx, int by, const TDiskQuery& q) const;
+
+   const TRaster* raster;
+   int xmax;
+   int ymax;
+   int nbx;                       // number of blocks along x
+   int nby;                       // number of blocks along y
+   vector<TBlock> blocks;          // in sparse storage only the blocks of blockhash
+   bool sparse;
+   TTileHash blockhash;            // position in blocks of each block with stored tiles (bx*nby + by)
+};
+
+
+// Block: the summary of a block to be changed, added in sparse storage if the block had no stored tiles
+inline TBlockIndex::TBlock& TBlockIndex::Block(int bx, int by)
+{
+ if (!sparse)
+   return blocks[bx*nby + by];
+ int slot = blockhash.Find(long(bx)*nby + by);
+ if (slot < 0)
+   {
+   slot = int(blocks.size());
+   blockhash.Insert(long(bx)*nby + by, slot);
+   blocks.push_back(Background(bx,by));
+   }
+ return blocks[slot];
+}
+
+// Summary: the summary of a block
+inline TBlockIndex::TBlock TBlockIndex::Summary(int bx, int by) const
+{
+ if (!sparse)
+   return blocks[bx*nby + by];
+ int slot = blockhash.Find(long(bx)*nby + by);
+ return (slot < 0) ? Background(bx,by) : blocks[slot];
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "freecells.h"
+
+
+// Constructor of TFreeCellIndex: creates an empty index (a full landscape)
+
+TFreeCellIndex::TFreeCellIndex() : top(0), background(-1), nbackground(0)
+{
+}
+
+
+// Build: indexes all the cells of the landscape as free, except cells with negative affinity which are never available
+
+void TFreeCellIndex::Build(const TRaster& land)
+{
+ affinity.clear();
+ for (int c=0; c<land.NClasses(); c++)
+   affinity.push_back(land.ClassAffinity(c));
+
+ if (land.Positions() > 0xFFFFFFFFL)   // positions are kept in 32 bits
+   {
+   cerr << "The landscape has more than 2^32 cells, too many for the index of free cells" << endl;
+   cerr << "...now exiting to system..." << endl;
+   exit(1);
+   }
+ cells.assign(affinity.size(), vector<uint32_t>());
+ cellpos.assign(land.Positions(), -1);
+ background = -1;
+ nbackground = 0;
+
+ if (land.Sparse())
+   {
+   // only the stored tiles are indexed cell by cell, the cells of the background tiles are counted
+   for (int k=0; k<land.NTiles(); k++)
+     {
+     int x, y;
+     land.TileOrigin(k, x, y);
+     for (int i=x; i<MIN(x+8,land.nrows()); i++)
+       for (int j=y; j<MIN(y+8,land.ncols()); j++)
+         Add(land, i, j);
+     }
+   background = land.BackgroundClass();
+   if (background >= 0)
+     nbackground = land.BackgroundCells();
+   }
+ else
+   {
+   for (int i=0; i<land.nrows(); i++)
+     for (int j=0; j<land.ncols(); j++)
+       Add(land, i, j);
+   }
+
+ top = 0;
+ while (top < int(cells.size()) && Empty(top))
+   top++;
+}
+
+
+// Add: stores an available cell in the array of its class while building the index
+
+void TFreeCellIndex::Add(const TRaster& land, int x, int y)
+{
+ int c = land.Class(x,y);
+ if (c >= 0)
+   {
+   long pos = land.Position(x,y);
+   cellpos[pos] = int(cells[c].size());
+   cells[c].push_back(uint32_t(pos));
+   }
+}
+
+
+// Remove: removes a cell from the free cells by moving the last cell of its class into its place
+
+void TFreeCellIndex::Remove(long pos, int c)
+{
+ if (pos < 0 || pos >= long(cellpos.size()) || cellpos[pos] < 0)   // cell already occupied or never available
+   return;
+
+ vector<uint32_t>& free = cells[c];
+ int k = cellpos[pos];
+ uint32_t last = free.back();
+ free[k] = last;
+ cellpos[last] = k;
+ free.pop_back();
+ cellpos[pos] = -1;
+
+ // if the best class was emptied, moves down to the next class with free cells
+ while (top < int(cells.size()) && Empty(top))
+   top++;
+}
+
+
+// Insert: adds a cell to the free cells of its class
+
+void TFreeCellIndex::Insert(long pos, int c)
+{
+ if (c < 0)                         // cell never available
+   return;
+ if (pos >= long(cellpos.size()))   // a tile stored after the index was built
+   cellpos.resize(pos+1, -1);
+ if (cellpos[pos] >= 0)             // cell already free
+   return;
+
+ cellpos[pos] = int(cells[c].size());
+ cells[c].push_back(uint32_t(pos));
+ if (c < top)
+   top = c;
+}
+
+
+// RemoveBackground: stops counting n cells of the background tiles, which were stored and inserted one by one
+
+void TFreeCellIndex::RemoveBackground(long n)
+{
+ nbackground -= n;
+ while (top < int(cells.size()) && Empty(top))
+   top++;
+}
@@ -0,0 +1,51 @@
+#ifndef _FREECELLS_H_
+#define _FREECELLS_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "raster.h"
+
+using namespace std;
+
+// TFreeCellIndex: groups the free cells of a landscape by affinity class
+// Cells are identified by their position in the storage of the raster (see TRaster::Position)
+// The classes are the affinity classes of the raster (see TRaster::Class)
+// Each class keeps an unordered array of its free cells and every cell knows its position in that array,
+// so a cell is claimed or released in constant time by swapping it with the last cell of its class
+// Classes are sorted by decreasing affinity and top is the first class that still has free cells
+// In sparse storage the cells of the background tiles have no position: they are only counted in their class
+// Positions are kept in 32 bits, so the index takes 8 bytes per cell (4 for the cell in its class and 4 for its
+// position in the array) and the raster can have at most 2^32 positions.
+
+class TFreeCellIndex
+{
+ public:
+   TFreeCellIndex();
+   void Build(const TRaster& land);
+   void Remove(long pos, int c);      // the cell at position pos, of class c, becomes occupied
+   void Insert(long pos, int c);      // the cell at position pos, of class c, becomes free
+   void RemoveBackground(long n);     // n cells of a background tile were stored and inserted one by one
+   bool Full() const {return top==int(cells.size());}
+   double MaxAffinity() const {return Full() ? -1 : affinity[top];}
+   long CountMax() const {return Full() ? 0 : long(cells[top].size()) + (top==background ? nbackground : 0);}
+   // position of the k-th free cell of maximum affinity, k in [0,CountMax()-1], -1 for a cell of the background tiles
+   long CellMax(long k) const {return (k < long(cells[top].size())) ? long(cells[top][k]) : -1;}
+   int NClasses() const {return int(cells.size());}
+   long Count(int c) const {return long(cells[c].size()) + (c==background ? nbackground : 0);}
+   long CountBackground() const {return nbackground;}
+   // position of the k-th free cell of class c, k in [0,Count(c)-1], -1 for a cell of the background tiles
+   long Cell(int c, long k) const {return (k < long(cells[c].size())) ? long(cells[c][k]) : -1;}
+ private:
+   bool Empty(int c) const {return cells[c].empty() && (c!=background || nbackground==0);}
+   void Add(const TRaster& land, int x, int y);
+
+   vector<double> affinity;        // affinity value of each class, in decreasing order
+   vector<vector<uint32_t> > cells;   // free cells of each class
+   vector<int> cellpos;            // position of each free cell in the array of its class, -1 if occupied
+   int top;                        // first class with free cells, equals the number of classes if the landscape is full
+   int background;                 // class of the background tiles of sparse storage, -1 if none
+   long nbackground;               // number of cells of the background tiles
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <algorithm>
+#include "frontier.h"
+
+
+// Constructor of TFrontier: creates an empty frontier with a small hash
+
+TFrontier::TFrontier() : table(64, -1), stamp(64, 0), generation(1), nused(0), shift(58)
+{
+}
+
+
+// Clear: empties the frontier for a new home range
+
+void TFrontier::Clear()
+{
+ best.clear();
+ heap.clear();
+ nused = 0;
+ if (++generation == 0)       // the stamps wrapped around, all entries are reset
+   {
+   stamp.assign(stamp.size(), 0);
+   generation = 1;
+   }
+}
+
+
+// Contains: whether a cell was inserted since the last Clear
+
+bool TFrontier::Contains(long cell) const
+{
+ size_t mask = table.size() - 1;
+ size_t h = size_t((uint64_t(cell) * 0x9E3779B97F4A7C15ull) >> shift);
+ while (stamp[h] == generation)
+   {
+   if (table[h] == cell)
+     return true;
+   h = (h + 1) & mask;
+   }
+ return false;
+}
+
+
+// Mark: adds a cell that is not in the hash to the hash, without adding it to the frontier
+
+void TFrontier::Mark(long cell)
+{
+ size_t mask = table.size() - 1;
+ size_t h = size_t((uint64_t(cell) * 0x9E3779B97F4A7C15ull) >> shift);
+ while (stamp[h] == generation)
+   h = (h + 1) & mask;
+ table[h] = cell;
+ stamp[h] = generation;
+ if (2 * ++nused > int(table.size()))
+   Grow();
+}
+
+
+// Insert: adds a cell with its value to the hash and to the best cells or to the heap
+
+void TFrontier::Insert(long cell, double score)
+{
+ Mark(cell);
+
+ TEntry e;
+ e.score = score;
+ e.cell = cell;
+ if (best.empty() || score > best.front().score)
+   {
+   // a new best value: the former best cells go to the heap
+   for (vector<TEntry>::iterator i=best.begin(); i!=best.end(); i++)
+     {
+     heap.push_back(*i);
+     push_heap(heap.begin(), heap.end());
+     }
+   best.assign(1, e);
+   }
+ else if (score == best.front().score)
+   {
+   vector<TEntry>::iterator i = best.begin();
+   while (i != best.end() && i->cell < cell)
+     i++;
+   best.insert(i, e);
+   }
+ else
+   {
+   heap.push_back(e);
+   push_heap(heap.begin(), heap.end());
+   }
+}
+
+
+// RemoveBest: removes the k-th best cell, the next best cells take its place when it was the last one
+
+void TFrontier::RemoveBest(int k)
+{
+ best.erase(best.begin() + k);
+ if (best.empty())
+   RefillBest();
+}
+
+
+// RefillBest: moves the cells with the highest value of the heap to the best cells
+// They leave the heap in increasing order of cells
+
+void TFrontier::RefillBest()
+{
+ while (!heap.empty() && (best.empty() || heap.front().score == best.front().score))
+   {
+   best.push_back(heap.front());
+   pop_heap(heap.begin(), heap.end());
+   heap.pop_back();
+   }
+}
+
+
+// Rebuild: separates again the best cells from the others after their values were set with SetScore
+
+void TFrontier::Rebuild()
+{
+ heap.insert(heap.end(), best.begin(), best.end());
+ best.clear();
+ make_heap(heap.begin(), heap.end());
+ RefillBest();
+}
+
+
+// Grow: doubles the size of the hash and adds again the entries of the current generation
+
+void TFrontier::Grow()
+{
+ vector<long> oldtable;
+ vector<unsigned> oldstamp;
+ oldtable.swap(table);
+ oldstamp.swap(stamp);
+ table.assign(2 * oldtable.size(), -1);
+ stamp.assign(2 * oldstamp.size(), 0);
+ shift--;
+
+ size_t mask = table.size() - 1;
+ for (size_t i=0; i<oldtable.size(); i++)
+   if (oldstamp[i] == generation)
+     {
+     size_t h = size_t((uint64_t(oldtable[i]) * 0x9E3779B97F4A7C15ull) >> shift);
+     while (stamp[h] == generation)
+       h = (h + 1) & mask;
+     table[h] = oldtable[i];
+     stamp[h] = generation;
+     }
+}
@@ -0,0 +1,57 @@
+#ifndef _FRONTIER_H_
+#define _FRONTIER_H_
+
+#include <vector>
+
+using namespace std;
+
+// TFrontier: the free cells next to a home range that is being expanded, with the value of each cell
+// Cells are identified by their packed index (row * number of columns + column), so that ordering the packed
+// indexes orders the cells as TCell::operator<. The cells with the best value are kept apart, sorted by cell,
+// and the others in a max-heap by value, so that the best cells are found without evaluating every cell again.
+// The values only change when the center of the home range moves; then they are all set again with SetScore
+// and the frontier is rebuilt with Rebuild.
+// Membership is an open addressing hash of every cell inserted since the last Clear: a cell that leaves the
+// frontier joins the home range, is no longer free and is never inserted again. Clear starts a new generation
+// instead of emptying the hash.
+
+class TFrontier
+{
+ public:
+   TFrontier();
+   void Clear();
+   bool Contains(long cell) const;
+   void Mark(long cell);                    // adds a cell to the hash only, so that it is never inserted
+   void Insert(long cell, double score);    // adds a cell that is not in the frontier
+   bool Empty() const {return best.empty();}
+   int CountBest() const {return int(best.size());}
+   long Best(int k) const {return best[k].cell;}   // k-th cell with the best value, in increasing order of cells
+   void RemoveBest(int k);
+   // all the cells, to set their values again
+   int Size() const {return int(heap.size() + best.size());}
+   long Cell(int k) const {return Entry(k).cell;}
+   void SetScore(int k, double score) {Entry(k).score = score;}
+   void Rebuild();
+ private:
+   struct TEntry
+   {
+      double score;
+      long cell;
+      // a < b if a comes after b: lower value, or same value and larger cell
+      bool operator<(const TEntry& b) const {return score < b.score || (score == b.score && cell > b.cell);}
+   };
+   TEntry& Entry(int k) {return (k < int(heap.size())) ? heap[k] : best[k-heap.size()];}
+   const TEntry& Entry(int k) const {return (k < int(heap.size())) ? heap[k] : best[k-heap.size()];}
+   void RefillBest();
+   void Grow();
+
+   vector<TEntry> best;         // cells with the best value, sorted by cell
+   vector<TEntry> heap;         // the other cells, max-heap by value
+   vector<long> table;          // hash of the cells inserted since the last Clear
+   vector<unsigned> stamp;      // an entry of the table is used if its stamp is the current generation
+   unsigned generation;
+   int nused;                   // number of used entries of the table
+   int shift;                   // 64 - log2 of the size of the table
+};
+
+#endif
@@ -1,10 +1,9 @@
 #include <fstream>
 #include <vector>
 #include <numeric>
-#include <deque>
+#include <algorithm>
 #include "landscape.h"
 #include "simulator.h"
-#include "individual.h"
 
 
 // TCell == operator overload: tests whether two cells are equal
@@ -50,7 +49,7 @@ ostream& operator<<(ostream& os, const THomeRange& hr)
 
 ostream& operator<<(ostream& s, const TLandscape& land)
 {
- const Mat_DP& mat = land.GetLandscapeMatrix();
+ const TRaster& mat = land.GetRaster();
 
  s << "{";
  for (int i=0; i<mat.nrows(); i++)
@@ -58,7 +57,7 @@ ostream& operator<<(ostream& s, const TLandscape& land)
    s << "{";
    for (int j=0; j<mat.ncols(); j++)
       {
-      s << mat[i][j];
+      s << mat.Affinity(i,j);
       if (j!=mat.ncols()-1) s << ", ";
       }
    s << "}";
@@ -77,9 +76,27 @@ TLandscape::TLandscape(TSimulator* simulatorIn, Mat_DP* land)
 {
  xmax = land->nrows();
  ymax = land->ncols();
- mland = *land;
- mfree = mland;
  simulator = simulatorIn;
+ raster.Build(*land, simulator->GetLandStorage(), simulator->GetLandLayout());
+ freecells.Build(raster);
+ blocks.Build(&raster);
+ if (simulator->GetDispersalMode()==2)
+   walks.Build(&raster, simulator->GetSinkAvoidance(), simulator->GetNeighAvoidance());
+}
+
+// Alternative TLandscape constructor (it is run when the object is first created): maps the landscape from a raster
+// file (see TRasterHeader in raster.h), which is read in place instead of being copied
+
+TLandscape::TLandscape(TSimulator* simulatorIn, const string& filename)
+{
+ simulator = simulatorIn;
+ raster.Map(filename);
+ xmax = raster.nrows();
+ ymax = raster.ncols();
+ freecells.Build(raster);
+ blocks.Build(&raster);
+ if (simulator->GetDispersalMode()==2)
+   walks.Build(&raster, simulator->GetSinkAvoidance(), simulator->GetNeighAvoidance());
 }
 
 // Alternative TLandscape constructor (it is run when the object is first created): stores the parameters of the landscape
@@ -91,9 +108,10 @@ TLandscape::TLandscape(TSimulator* simulatorIn, double habaffty,
 {
  xmax = xmaxIn;
  ymax = ymaxIn;
- mland = Mat_DP(habaffty,xmax,ymax);
- mfree = mland;
  simulator = simulatorIn;
+ raster.Build(Mat_DP(habaffty,xmax,ymax), simulator->GetLandStorage(), simulator->GetLandLayout());
+ freecells.Build(raster);
+ blocks.Build(&raster);
 }
 
 // TLandscape destructor (it is run when the object is eliminated)
@@ -102,17 +120,105 @@ TLandscape::~TLandscape()
 }
 
 
-// Update: updates the matrix of free cells (mfree) by assigning -1 to all ocuppied cells
+// Update: releases the cells claimed by failed settlement attempts since the last update
+// Dead adults release their own cells in ReleaseHomeRange and settlers claim theirs in PlaceHomeRange,
+// so the free cells only change where individuals arrived or left instead of being rebuilt from the landscape
+
+void TLandscape::Update()
+{
+ ReleaseHomeRange(abandoned);
+ abandoned.clear();
+}
+
+
+// ReleaseHomeRange: frees the cells of a home range by restoring their affinity in the matrix of free cells
+
+void TLandscape::ReleaseHomeRange(const THomeRange& homerange)
+{
+ for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); i++)  // for all cells of the home range
+   FreeCell(*i);  // the cell is free again
+}
+
+// ReleaseHomeRange: frees the n cells of a home range stored in an array (see TPopulation)
+
+void TLandscape::ReleaseHomeRange(const TCell* cells, unsigned int n)
+{
+ for (unsigned int i=0; i<n; i++)
+   FreeCell(cells[i]);
+}
+
+
+// OccupyCell: marks a cell as occupied in the raster and in the indexes of free cells
+
+void TLandscape::OccupyCell(const TCell& cell)
+{
+ if (!raster.Stored(cell.x,cell.y))   // sparse storage: the first cell occupied in a background tile
+   StoreTile(cell);
+ double affinity = raster.FreeAffinity(cell.x,cell.y);
+ raster.Occupy(cell.x,cell.y);
+ freecells.Remove(raster.Position(cell.x,cell.y), raster.Class(cell.x,cell.y));
+ blocks.Occupy(cell.x, cell.y, affinity);
+ if (affinity >= 0)   // the cell was free
+   walks.Occupy(cell.x, cell.y);
+}
+
+
+// FreeCell: frees a cell in the raster and returns it to the indexes of free cells
 
-void TLandscape::Update(const TPopulation& population)
+void TLandscape::FreeCell(const TCell& cell)
 {
-  mfree = mland;
-  for(TPopulation::const_iterator individual=population.begin(); individual!=population.end(); individual++)
-	  { //for all individuals of the population
-		const THomeRange& homerange = individual->GetHomeRange();
-		for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end();i++)  // for all cells of the home range
-			mfree[i->x][i->y]=-1;  // assign -1 to the occupied cell
-	  }
+ if (raster.IsFree(cell.x,cell.y))   // the cell is already free
+   return;
+ raster.Release(cell.x,cell.y);
+ freecells.Insert(raster.Position(cell.x,cell.y), raster.Class(cell.x,cell.y));
+ blocks.Free(cell.x, cell.y, raster.FreeAffinity(cell.x,cell.y));
+ walks.Free(cell.x, cell.y);
+}
+
+
+// StoreTile: stores the background tile of a cell in sparse storage and indexes its cells one by one
+// instead of counting them with the cells of the background tiles
+
+void TLandscape::StoreTile(const TCell& cell)
+{
+ raster.StoreTile(cell.x,cell.y);
+ int x0, y0;
+ raster.TileOrigin(raster.NTiles()-1, x0, y0);
+ long n = 0;
+ for (int i=x0; i<MIN(x0+8,xmax); i++)
+   for (int j=y0; j<MIN(y0+8,ymax); j++, n++)
+     freecells.Insert(raster.Position(i,j), raster.Class(i,j));
+ freecells.RemoveBackground(n);
+}
+
+
+// BackgroundCell: chooses a random cell of the background tiles of sparse storage, all of them free
+// Draws cells with the generator rnd until one falls in a background tile, which takes few draws as these tiles
+// are most of a sparse landscape. After 64 draws, when the stored tiles are most of the landscape, it draws the
+// number of a background cell instead (see TRaster::BackgroundCell).
+
+TCell TLandscape::BackgroundCell(StochasticLib1* rnd) const
+{
+ TCell cell;
+ for (int i=0; i<64; i++)
+   {
+   cell.x = rnd->IRandom(0,xmax-1);
+   cell.y = rnd->IRandom(0,ymax-1);
+   if (!raster.Stored(cell.x,cell.y))
+     return cell;
+   }
+ return BackgroundCell(MIN(long(rnd->Random()*BackgroundCells()), BackgroundCells()-1));
+}
+
+
+// BackgroundCell: the k-th cell of the background tiles of sparse storage, k in [0,BackgroundCells()-1], found in a
+// time of order the logarithm of the number of tiles (see TRaster::BackgroundCell)
+
+TCell TLandscape::BackgroundCell(long k) const
+{
+ TCell cell;
+ raster.BackgroundCell(k, cell.x, cell.y);
+ return cell;
 }
 
 
@@ -136,28 +242,16 @@ bool TLandscape::ChooseStartingPoint(TCell& startcell, TCell& mothercell)
 // Chooses starting point for the home range based on global dispersal
 bool TLandscape::ChooseStartingPointMode0(TCell& startcell)
 {
- double maxaffty = mfree.max();  // calculates the maximum available affinity in the matrix
- if (maxaffty<0)                 // if matrix if full it is not possible to choose start point
+ if (freecells.Full())           // if matrix if full it is not possible to choose start point
    return false;
 
- // creates vector to store available cells in the lansdcape
- vector<TCell> vlandmax(mland.nrows() * mland.ncols());
-
- int ncells=0;
-
- // identifies available cells in the landscape with maximum affinity
- for (int i=0; i<xmax; i++)
-   for (int j=0; j<ymax; j++)
-      if (mfree[i][j]==maxaffty)
-         {
-         vlandmax[ncells]=TCell(i,j);
-         ncells++;
-         }
-
- // generates a random number between 0 and ncells - 1
- int start = simulator->sto->IRandom(0,ncells-1);
- // selects a random cell from the vector of available cells with maximum affinity
- startcell = vlandmax[start];
+ // generates a random number between 0 and ncells - 1, ncells being the number of available cells with maximum affinity
+ int start = simulator->sto->IRandom(0,freecells.CountMax()-1);
+ // selects a random cell from the available cells with maximum affinity
+ long pos = freecells.CellMax(start);
+ if (pos < 0)                    // a cell of the background tiles of sparse storage
+   startcell = BackgroundCell(simulator->sto);
+ else raster.PositionCell(pos, startcell.x, startcell.y);
  return true;
 }
 
@@ -166,31 +260,27 @@ bool TLandscape::ChooseStartingPointMode0(TCell& startcell)
 bool TLandscape::ChooseStartingPointMode1(TCell& startcell,
                                           TCell& mothercell)
 {
- double maxaffty = mfree.max(); // calculates the maximum available affinity in the matrix
+ return KernelSearch(startcell, mothercell, *simulator->sto, query);
+}
+
+// KernelSearch: chooses the starting point of dispersal mode 1 with the random generator rnd and the disk query q
+// It only reads the landscape, so that several searches can run at the same time (see Speculate)
+template<class R>
+bool TLandscape::KernelSearch(TCell& startcell, const TCell& mothercell, R& rnd, TDiskQuery& q) const
+{
+ double maxaffty = freecells.MaxAffinity(); // maximum available affinity in the matrix
  if (maxaffty<0)                // if matrix if full it is not possible to choose start point
    return false;
    
  int r=simulator->GetDispersalDistance();
- int rsq=SQR(r);                 // stores rˆ2 in variable rsq
-
- vector<TCell> vlandmax(4*rsq);  // Creates vector to store dispersal kernel. The size is 4*rˆ2
-                                 // This is a square, centered in the mother cell, with width 2r and height 2r
-
- int ncells=0;
-
- for (int i=MAX(mothercell.x-r,0); i<MIN(mothercell.x+r+1,xmax); i++)
-   for (int j=MAX(mothercell.y-r,0); j<MIN(mothercell.y+r+1,ymax); j++)
-       // for all cells in the square enclosing the kernel
-     if (mfree[i][j]==maxaffty) // if the cell is free
-       if (SQR(i-mothercell.x)+SQR(j-mothercell.y) <= rsq) // and if the cell is in a circle of radius r
-         {
-         vlandmax[ncells]=TCell(i,j); // then add the cell to dispersal kernel
-         ncells++;
-         }
+
+ // counts the free cells with maximum affinity in a circle of radius r centered in the mother cell (the dispersal kernel)
+ long ncells = blocks.CountInDisk(mothercell.x, mothercell.y, r, maxaffty, q);
+
  if (ncells>0)
   {
-  int start = simulator->sto->IRandom(0,ncells-1); // generates random integer between 0 and ncells-1
-  startcell = vlandmax[start]; // choose a random cell for the vector of the dispersal kernel cells
+  long start = rnd.IRandom(0,ncells-1); // generates random integer between 0 and ncells-1
+  blocks.CellInDisk(start, startcell.x, startcell.y, q); // choose a random cell of the dispersal kernel
   return true;
   }
  else return false;
@@ -201,51 +291,50 @@ bool TLandscape::ChooseStartingPointMode1(TCell& startcell,
 bool TLandscape::ChooseStartingPointMode2(TCell& startcell,
                                           TCell& mothercell)
 {
-    int r=simulator->GetDispersalDistance();
-    
-    TCell cell=mothercell; // current cell in dispersal
+ int r=simulator->GetDispersalDistance();
+ if (!RandomWalk(startcell, mothercell, r, *simulator->sto, NULL))
+   return false;
+ if (!raster.IsFree(startcell.x,startcell.y))  // if cell occupied
+   return false;  // dispersal unsuccessul
+ return true;
+}
+
+// RandomWalk: the random walk of dispersal mode 2 of the given number of steps from startcell with the random generator
+// rnd, stores its last cell in endcell and returns whether the walk ended (the juvenile did not die in a sink nor got
+// stuck), whether the cell is free or not
+// If path is not NULL it gets the cell where each step began, followed by (-1,-1) if the walk did not end.
+// It only reads the landscape, so that several walks can run at the same time (see Speculate)
+template<class R>
+bool TLandscape::RandomWalk(TCell& endcell, const TCell& startcell, int steps, R& rnd, TCell* path) const
+{
+    TCell cell=startcell; // current cell in dispersal
+    bool sink=raster.IsSink(cell.x,cell.y);
     
-    for (int walkstep=0; walkstep<r; walkstep++)   // at each dispersal step
+    for (int walkstep=0; walkstep<steps; walkstep++)   // at each dispersal step
     {
-        TCell newcell;
-        // creates vector with neighbor cells of current cell
-        std::vector<TCell> neigh;
-        if (cell.x > 0) neigh.push_back(TCell(cell.x-1,cell.y));
-        if (cell.y > 0) neigh.push_back(TCell(cell.x,cell.y-1));
-        if (cell.x < xmax-1) neigh.push_back(TCell(cell.x+1,cell.y));
-        if (cell.y < ymax-1) neigh.push_back(TCell(cell.x,cell.y+1));
+        if (path)
+            path[walkstep]=cell;
         
-        // creates vector with cumulative probabilities for each neighbor cell
-        std::vector<double> neighprob;
-        double cumprob=0;
-        for (vector<TCell>::iterator i = neigh.begin(); i!=neigh.end(); i++)
-         {
-             double prob=1.0;   // default probability of dispersing to a neighbor
-             if ((mland[i->x][i->y]==0)&&(mfree[i->x][i->y]<0)) // if sink habitat and occupied
-                 prob=1-MAX(simulator->GetSinkAvoidance(),simulator->GetNeighAvoidance());  // decreases prob. by maximum of sinkavoidance and neighavoidance
-             else if (mland[i->x][i->y]==0) // if sink habitat only
-                 prob=1-simulator->GetSinkAvoidance();
-             else if (mfree[i->x][i->y]<0) // if occupied only
-                 prob=1-simulator->GetNeighAvoidance();
-             cumprob+=prob;
-             neighprob.push_back(cumprob);
-         }
+        // the neighbor cells of the current cell and their cumulative probabilities (see TWalkIndex)
+        const TWalkStep& neigh=walks.Step(cell.x,cell.y);
         
         // chooses a cell with its probabilty (multinomial) and updates the current cell
-		if (cumprob==0) // if all probabilities are zero then cannot find starting point
+		if (neigh.n==0) // if all probabilities are zero then cannot find starting point
+		{
+		    if (path && walkstep+1<steps) path[walkstep+1]=TCell(-1,-1);
 		    return false;
-		else {
-			double urand=simulator->sto->Random();
-			for (int k=neigh.size()-1; k>=0; k--)
-				if (urand <= neighprob[k]/cumprob)
-					newcell=neigh[k];
 		}
+		int k=neigh.Choose(rnd.Random());
+		TCell newcell(cell.x+neigh.dx[k],cell.y+neigh.dy[k]);
 		
 		// if in a sink cell apply sink dispersal mortality and move again
-        if ((mland[newcell.x][newcell.y]==0)&&(mland[cell.x][cell.y]!=0))
+        if (neigh.sink[k]&&!sink)
         {
-			if (simulator->sto->Random()<=simulator->GetSinkMortality())
+			if (rnd.Random()<=simulator->GetSinkMortality())
+			{
+				if (path && walkstep+1<steps) path[walkstep+1]=TCell(-1,-1);
 				return false;
+			}
             
             int dirx = newcell.x-cell.x;
             int diry = newcell.y-cell.y;
@@ -269,15 +358,181 @@ bool TLandscape::ChooseStartingPointMode2(TCell& startcell,
                 if (newcell.y > 0) newcell.y--;
                 else newcell.y++;
             }
-            
+            sink=raster.IsSink(newcell.x,newcell.y);
         }
+        else sink=neigh.sink[k];
         cell=newcell;
     }
-    startcell=cell;
+    endcell=cell;
+    return true;
+}
+
+// Walk: runs the random walks of dispersal mode 2 of n juveniles in lockstep, one step of all the walks at a time
+// cells holds the mother cell of each juvenile and gets the last cell of its walk, and arrived whether the walk
+// ended (the juvenile did not die in a sink nor got stuck). These are the walks of ChooseStartingPointMode2 without
+// the final check of the cell, which is left to the settlement of each juvenile in turn (see PlaceHomeRangeAt).
+// The walks are independent when the steps do not depend on occupancy (no neighbor avoidance). A step of a walk
+// is the same for every walk, with masks instead of branches: it always takes two random numbers, for the move
+// and for sink dispersal mortality, and always calculates the move out of a sink, which are only used when the walk
+// enters a sink. So the random numbers are not those of the walks one at a time. The walks still running are
+// kept in an array that is compacted when some of them end. The steps are plain loops over the walks, without
+// vector instructions: the gain over the walks one at a time (about a fifth) comes from the fewer branches and from
+// reading the walk codes instead of the raster.
+
+void TLandscape::Walk(int n, TCell* cells, int8_t* arrived)
+{
+ int r=simulator->GetDispersalDistance();
+ double sinkmortality=simulator->GetSinkMortality();
+ walkers.resize(n);
+ for (int i=0; i<n; i++)
+   {
+   walkers[i].x=cells[i].x;
+   walkers[i].y=cells[i].y;
+   walkers[i].id=i;
+   arrived[i]=1;
+   }
+
+ int m=n;   // walks that have not ended
+ for (int walkstep=0; walkstep<r && m>0; walkstep++)
+   {
+   int ended=0;   // whether a walk ended in this step
+   for (int i=0; i<m; i++)
+     {
+     TWalker& w=walkers[i];
+     double u=simulator->sto->Random();   // move
+     double v=simulator->sto->Random();   // sink dispersal mortality
+     const TWalkStep& neigh=walks.Step(w.x,w.y);
+     int k=neigh.Choose(u);    // a missing neighbor, with no move, if the walk cannot move
+     int dx=neigh.dx[k];
+     int dy=neigh.dy[k];
+     int x=w.x+dx;
+     int y=w.y+dy;
+     int enter=neigh.sink[k] & !neigh.insink;
+     // in a sink cell it moves again in the same direction, or back at the border
+     int jx=x + ((x+dx>=0 && x+dx<xmax) ? dx : -dx);
+     int jy=y + ((y+dy>=0 && y+dy<ymax) ? dy : -dy);
+     w.x=enter ? jx : x;
+     w.y=enter ? jy : y;
+     w.dead=(neigh.n==0) | (enter & (v<=sinkmortality));
+     ended|=w.dead;
+     }
+
+   // removes the walks that ended
+   if (ended)
+     {
+     int j=0;
+     for (int i=0; i<m; i++)
+       if (walkers[i].dead)
+         arrived[walkers[i].id]=0;
+       else walkers[j++]=walkers[i];
+     m=j;
+     }
+   }
+ for (int i=0; i<m; i++)
+   cells[walkers[i].id]=TCell(walkers[i].x,walkers[i].y);
+}
+
+
+// Speculate: the first phase of the settlement of n juveniles in two phases (see TPopulation::SettleSpeculative),
+// which looks for a starting cell for all of them at the same time in nthreads threads, this one and the workers of the pool
+// mothers holds the mother cell of each juvenile, starts gets the cell it found and found whether it found one.
+// The searches only read the landscape as it is now, the snapshot, and each juvenile searches with its own random
+// stream, so what it finds does not depend on the thread nor on the number of threads. These are the searches of
+// ChooseStartingPointMode1 and ChooseStartingPointMode2, without the final check of the cell of the walk. With
+// neighbor avoidance the cells where the steps of the walks began are kept for Confirm.
+// With home ranges of more than one cell (growth not NULL) the home ranges also grow from the free cells found, each
+// with a copy of the random stream of its juvenile in growth, and what they read is kept for PlaceHomeRangeAt.
 
-    if (mfree[cell.x][cell.y]<0)  // if cell occupied
-        return false;  // dispersal unsuccessul
-    else return true;
+void TLandscape::Speculate(int n, const TCell* mothers, TCell* starts, int8_t* found, TRandomStream* streams,
+                           TRandomStream* growth, int nthreads)
+{
+ int r=simulator->GetDispersalDistance();
+ snapaffty=freecells.MaxAffinity();
+ if (simulator->GetDispersalMode()==2 && simulator->GetNeighAvoidance()>0)
+   {
+   paths.resize(long(n)*r);
+   walks.Untrack();   // the codes that change from now on are marked
+   walks.Track();
+   }
+ if (growth)
+   {
+   if (int(grown.size())<n)
+     grown.resize(n);
+   grownsize.resize(n);
+   }
+
+ nthreads=MAX(1,MIN(nthreads,n));
+ workers.Run(nthreads, [&](int t) {
+   SpeculateRange(int(long(n)*t/nthreads), int(long(n)*(t+1)/nthreads), mothers, starts, found, streams, growth);
+ });
+}
+
+// SpeculateRange: the searches of Speculate of the juveniles from first to last-1, in one thread
+
+void TLandscape::SpeculateRange(int first, int last, const TCell* mothers, TCell* starts, int8_t* found,
+                                TRandomStream* streams, TRandomStream* growth)
+{
+ int r=simulator->GetDispersalDistance();
+ bool keeppaths=(simulator->GetNeighAvoidance()>0 && r>0);   // as in Speculate, only used by the walks
+ TDiskQuery q;   // each thread has its own search in the dispersal kernel, frontier and home range
+ TFrontier front;
+ THomeRange homerange;
+ for (int j=first; j<last; j++)
+   {
+   if (simulator->GetDispersalMode()==1)
+     found[j]=KernelSearch(starts[j], mothers[j], streams[j], q);
+   else found[j]=RandomWalk(starts[j], mothers[j], r, streams[j], keeppaths ? &paths[long(j)*r] : NULL);
+
+   if (!growth)
+     continue;
+   grown[j].clear();
+   grownsize[j]=0;
+   if (found[j] && raster.IsFree(starts[j].x,starts[j].y))
+     {
+     TRandomStream rnd=growth[j];   // the stream itself is kept for the home range that grows again
+     homerange.assign(1, starts[j]);
+     GrowHomeRange(homerange, front, rnd, true);
+     for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); ++i)
+       grown[j].push_back(CellIndex(*i));
+     for (int k=0; k<front.Size(); k++)
+       grown[j].push_back(front.Cell(k));
+     grownsize[j]=int(homerange.size());
+     }
+   }
+}
+
+// Confirm: the second phase of the settlement in two phases, for the juvenile k of Speculate, when the juveniles
+// before it have settled. Returns whether the juvenile has a free starting cell, in start.
+// Since the snapshot cells have only been occupied, and the juvenile gets a cell with the same probabilities as
+// a search with the landscape as it is now, checking what changed and searching again with its random stream:
+// Mode 1: the search draws one of the free cells of maximum affinity in the kernel. While the maximum affinity
+// is that of the snapshot these cells are some of the cells of the snapshot, so the cell found, if it is still free,
+// is a draw among them. Otherwise the juvenile searches again.
+// Mode 2: a step of the walk only depends on the code of the cell where it began (see TWalkIndex), and without
+// neighbor avoidance the codes of free and occupied neighbors give the same steps. Otherwise the walk stands up to
+// the first of its cells whose code changed, and goes on from there. Then the last cell must be free.
+
+bool TLandscape::Confirm(int k, TCell& start, bool found, const TCell& mother, TRandomStream& rnd)
+{
+ if (simulator->GetDispersalMode()==1)
+   {
+   if (freecells.MaxAffinity()==snapaffty && (!found || raster.IsFree(start.x,start.y)))
+     return found;
+   return KernelSearch(start, mother, rnd, query);
+   }
+
+ int r=simulator->GetDispersalDistance();
+ if (simulator->GetNeighAvoidance()>0 && r>0)
+   {
+   const TCell* path=&paths[long(k)*r];
+   for (int s=0; s<r && path[s].x>=0; s++)
+     if (walks.Changed(path[s].x,path[s].y))
+       {
+       found=RandomWalk(start, path[s], r-s, rnd, NULL);
+       break;
+       }
+   }
+ return found && raster.IsFree(start.x,start.y);
 }
 
 
@@ -290,44 +545,195 @@ bool TLandscape::PlaceHomeRange(THomeRange& homerange,
 
  while (ChooseStartingPoint(start, hrcentermother))   // while it is possible to find a starting cell for the HR expansion
     {
-    mfree[start.x][start.y]=-1;
+    OccupyCell(start);
     homerange.push_back(start);         // Stores the starting cell in the home range
     if (ExpandHomeRange(homerange))     // If it is possible to exand home range to its desired size
       return true;                 // return succes
-    else homerange.clear();        // else fails
+    else   // else fails, the cells stay claimed until the next Update
+      {
+      abandoned.insert(abandoned.end(), homerange.begin(), homerange.end());
+      homerange.clear();
+      }
     }
 
  return false;    // if it was not possible to find a start cell fails
 }
 
+// PlaceCell: places a home range of a single cell (home range size 1) starting the dispersal in the mother cell
+// There is nothing to expand, so the home range is the starting cell, stored in cell as CellIndex
+
+bool TLandscape::PlaceCell(long& cell, TCell& hrcentermother)
+{
+ TCell start;
+
+ if (!ChooseStartingPoint(start, hrcentermother))   // if it was not possible to find a start cell fails
+   return false;
+ OccupyCell(start);
+ cell = CellIndex(start);
+ return true;
+}
+
+// PlaceHomeRangeAt: as PlaceHomeRange, when the first dispersal of the juvenile ended in start (a walk of Walk, or
+// a search of Speculate checked by Confirm)
+// If the home range cannot be completed from start the juvenile disperses again as in PlaceHomeRange
+
+bool TLandscape::PlaceHomeRangeAt(THomeRange& homerange, TCell& hrcentermother, const TCell& start)
+{
+ if (!raster.IsFree(start.x,start.y))   // the walk ended in an occupied cell, dispersal unsuccessful
+   return false;
+ OccupyCell(start);
+ homerange.push_back(start);
+ if (ExpandHomeRange(homerange))
+   return true;
+ abandoned.insert(abandoned.end(), homerange.begin(), homerange.end());
+ homerange.clear();
+ return PlaceHomeRange(homerange, hrcentermother);
+}
+
+// PlaceHomeRangeAt: as PlaceHomeRangeAt for the juvenile k of Speculate, when Confirm gave start, with its random stream
+// growth for the growth of the home range
+// If the juvenile starts in the cell where its home range grew in Speculate and all the free cells that this growth read
+// are still free (no cell was freed since), the home range is the same as it would grow now, with the same random
+// numbers, and is taken as it is. Otherwise it grows again.
+
+bool TLandscape::PlaceHomeRangeAt(int k, THomeRange& homerange, TCell& hrcentermother, const TCell& start,
+                                  TRandomStream& growth)
+{
+ if (!raster.IsFree(start.x,start.y))
+   return false;
+ const vector<long>& cells=grown[k];
+ bool same=(!cells.empty() && cells[0]==CellIndex(start));
+ for (unsigned int i=1; same && i<cells.size(); i++)
+   {
+   TCell cell=IndexCell(cells[i]);
+   same=raster.IsFree(cell.x,cell.y);
+   }
+
+ bool complete;
+ if (same)
+   {
+   for (int i=0; i<grownsize[k]; i++)
+     {
+     TCell cell=IndexCell(cells[i]);
+     OccupyCell(cell);
+     homerange.push_back(cell);
+     }
+   complete=(homerange.size()==simulator->GetHomeRangeSize());
+   }
+ else
+   {
+   OccupyCell(start);
+   homerange.push_back(start);
+   complete=GrowHomeRange(homerange, frontier, growth, false);
+   }
+ if (complete)
+   return true;
+ abandoned.insert(abandoned.end(), homerange.begin(), homerange.end());
+ homerange.clear();
+ return PlaceHomeRange(homerange, hrcentermother);
+}
+
+// PlaceCellAt: as PlaceCell, when the dispersal of the juvenile ended in start (see PlaceHomeRangeAt)
+
+bool TLandscape::PlaceCellAt(long& cell, const TCell& start)
+{
+ if (!raster.IsFree(start.x,start.y))   // the walk ended in an occupied cell, dispersal unsuccessful
+   return false;
+ OccupyCell(start);
+ cell = CellIndex(start);
+ return true;
+}
+
+// PlaceCells: places n home ranges of a single cell with global dispersal, all at once, appending their cells
+// to cells as CellIndex, and returns the number placed (the others are floaters)
+// The juveniles fill the classes of free cells from the best one, each class with a random sample without
+// replacement of its cells: a partial Fisher-Yates shuffle of the free cells of the class, where each cell drawn
+// is swapped out of the class by OccupyCell. The draws are those of PlaceCell for each juvenile, and the
+// juveniles that find the landscape full take no time.
+
+long TLandscape::PlaceCells(long n, vector<long>& cells)
+{
+ long placed = 0;
+ for (; placed<n && !freecells.Full(); placed++)
+   {
+   TCell start;
+   ChooseStartingPointMode0(start);
+   OccupyCell(start);
+   cells.push_back(CellIndex(start));
+   }
+ return placed;
+}
+
 //---------------------------------------------------------------------------
 
+// ExpandHomeRange: adds cells to the home range, one at a time, until it has the home range size
+// The frontier keeps the free cells next to the home range with their values, and only grows with the neighbors
+// of each new cell. The center is calculated from running sums as in HomeRangeCenter, and the values of the
+// frontier are only calculated again when the rounded center moves (they do not depend on it without distance
+// weight). The home range keeps the order in which its cells were added.
+
 bool TLandscape::ExpandHomeRange(THomeRange& homerange)
 {
- TNeighbors neighbors;
+ return GrowHomeRange(homerange, frontier, *simulator->sto, false);
+}
+
+// GrowHomeRange: the expansion of ExpandHomeRange with the frontier front and the random generator rnd
+// If speculate is true the cells are not occupied, and the cells of the home range are kept out of the frontier by its
+// hash instead, so that it only reads the landscape and several home ranges can grow at the same time (see Speculate).
+// Then the free cells read are those of the home range and of the frontier.
+template<class R>
+bool TLandscape::GrowHomeRange(THomeRange& homerange, TFrontier& front, R& rnd, bool speculate)
+{
+ double x=0;
+ double y=0;
+ double puse=0;
+ for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); ++i)
+   {
+   double a = raster.Affinity(i->x,i->y);
+   puse += a;
+   x += i->x * a;
+   y += i->y * a;
+   }
+ front.Clear();
+ if (speculate)
+   for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); ++i)
+     front.Mark(CellIndex(*i));
+ TCell scored(-1,-1);   // center of the values in the frontier
 
  while (homerange.size() < simulator->GetHomeRangeSize())
    {
-   CalculateNeighbors(homerange, neighbors);
-   if (neighbors.empty())
+   TCell ctr = (homerange.size()==1) ? homerange.front() : TCell(round(x/puse),round(y/puse));
+   if (!(ctr==scored) && simulator->GetDistanceWeight()!=0)
+     {
+     for (int k=0; k<front.Size(); k++)
+       front.SetScore(k, EvaluatePoint(IndexCell(front.Cell(k)),ctr));
+     front.Rebuild();
+     scored = ctr;
+     }
+   CalculateNeighbors(homerange.back(), ctr, front);
+   if (front.Empty())
       return false;
-   TCell pt = ChoosePoint(homerange, neighbors);
-   mfree[pt.x][pt.y]=-1;
+   TCell pt = ChoosePoint(front, rnd);
+   if (!speculate)
+     OccupyCell(pt);
    homerange.push_back(pt);
+   double a = raster.Affinity(pt.x,pt.y);
+   puse += a;
+   x += pt.x * a;
+   y += pt.y * a;
    }
  return true;
 }
 
 //---------------------------------------------------------------------------
+// CalculateNeighbors: adds to the frontier front the free neighbors of the last cell of the home range,
+// with their values for the center ctr
 
-void TLandscape::CalculateNeighbors(THomeRange& homerange,
-                                    TNeighbors& neighbors)
+void TLandscape::CalculateNeighbors(const TCell& last, const TCell& ctr, TFrontier& front)
 {
  int neighdiff[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
                         {0, 1}, {1, -1}, {1, 0}, {1, 1}};
 
- const TCell& last = homerange.back();
- TNeighbors newneigh;
  for (int i=0; i<8; i++)
    {
    int x = last.x + neighdiff[i][0];
@@ -335,44 +741,22 @@ void TLandscape::CalculateNeighbors(THomeRange& homerange,
 
    if ((x < xmax) && (x >= 0) &&
        (y < ymax) && (y >= 0))
-      if (mfree[x][y] >= 0)
-         newneigh.push_back(TCell(x,y));
+      if (raster.IsFree(x,y) && !front.Contains(CellIndex(TCell(x,y))))
+         front.Insert(CellIndex(TCell(x,y)), EvaluatePoint(TCell(x,y),ctr));
    }
- newneigh.sort();
- neighbors.merge(newneigh);
- neighbors.unique();
- homerange.sort();
- set_difference(neighbors.begin(),neighbors.end(),
-                homerange.begin(),homerange.end(),
-                neighbors.begin());
 }
 
 //---------------------------------------------------------------------------
+// ChoosePoint: removes from the frontier front and returns one of the cells with the best value for the home range
+// The ties are drawn with the random generator rnd in the order of the cells, as they were when the frontier was a sorted list
 
-TCell TLandscape::ChoosePoint(const THomeRange& homerange,
-                              TNeighbors& neighbors)
+template<class R>
+TCell TLandscape::ChoosePoint(TFrontier& front, R& rnd)
 {
- TCell ctr = HomeRangeCenter(homerange);
-
- TNeighbors::iterator i;
- double max=-10000.;
- deque<TNeighbors::iterator> bestneigh;
- double val;
- for (i=neighbors.begin(); i!=neighbors.end(); ++i)
-   {
-   val = EvaluatePoint(*i,ctr);
-   if (val>max)
-      {
-      max = val;
-      bestneigh.clear();
-      bestneigh.push_back(i);
-      }
-   else if (val==max)
-      bestneigh.push_back(i);
-   }
- int rndneigh = simulator->sto->IRandom(0,bestneigh.size()-1);
- neighbors.erase(bestneigh[rndneigh]);
- return *(bestneigh[rndneigh]);
+ int rndneigh = rnd.IRandom(0,front.CountBest()-1);
+ TCell pt = IndexCell(front.Best(rndneigh));
+ front.RemoveBest(rndneigh);
+ return pt;
 }
 
 //---------------------------------------------------------------------------
@@ -389,9 +773,10 @@ TCell TLandscape::HomeRangeCenter (const THomeRange& homerange)
 	
  for (i=homerange.begin(); i!=homerange.end(); ++i)
    {
-   puse += mland[i->x][i->y];
-   x += i->x * mland[i->x][i->y];
-   y += i->y * mland[i->x][i->y];
+   double a = raster.Affinity(i->x,i->y);
+   puse += a;
+   x += i->x * a;
+   y += i->y * a;
    }
  if (homerange.empty())
    return TCell(0,0);
@@ -401,9 +786,71 @@ TCell TLandscape::HomeRangeCenter (const THomeRange& homerange)
 //---------------------------------------------------------------------------
 double TLandscape::EvaluatePoint (const TCell& pt, const TCell& ctr)
 {
+ if (raster.Compact())   // compact storage: single precision on the quantized affinity
+   {
+   float distw = float(simulator->GetDistanceWeight()) * float(SQR(pt.x-ctr.x)+SQR(pt.y-ctr.y));
+   return raster.AffinityF(pt.x,pt.y)*(1-distw);
+   }
+
  double distw = simulator->GetDistanceWeight() * Distance(pt, ctr);
 
- return mland[pt.x][pt.y]*(1-distw);
+ return raster.Affinity(pt.x,pt.y)*(1-distw);
+}
+
+//---------------------------------------------------------------------------
+// HomeRangeFitness: sums the value of the cells of a home range with center ctr
+// Without distance weight the value of a cell is its affinity, as given by EvaluatePoint
+
+double TLandscape::HomeRangeFitness(const THomeRange& homerange, const TCell& ctr)
+{
+ double d = 0;
+ if (simulator->GetDistanceWeight()==0)
+   {
+   if (raster.Compact())
+     for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); i++)
+       d+=raster.AffinityF(i->x,i->y);
+   else
+     for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); i++)
+       d+=raster.Affinity(i->x,i->y);
+   return d;
+   }
+ for (THomeRange::const_iterator i=homerange.begin(); i!=homerange.end(); i++)
+   d+=EvaluatePoint(*i,ctr);
+ return d;
+}
+
+//---------------------------------------------------------------------------
+// CellFitness: value of a home range of a single cell, which is its own center, as given by EvaluatePoint
+
+double TLandscape::CellFitness(long cell)
+{
+ TCell pt = IndexCell(cell);
+ if (raster.Compact())
+   return raster.AffinityF(pt.x,pt.y);
+ return raster.Affinity(pt.x,pt.y);
+}
+
+//---------------------------------------------------------------------------
+// ClassFitness: value of a home range of a single cell of class c, the same as CellFitness for each of its cells
+
+double TLandscape::ClassFitness(int c) const
+{
+ if (raster.Compact())
+   return float(raster.ClassAffinity(c));
+ return raster.ClassAffinity(c);
+}
+
+//---------------------------------------------------------------------------
+// ClassCell: stores in cell the k-th free cell of class c, k in [0,ClassCells(c)-1], and returns true
+// Returns false for the cells of the background tiles of sparse storage, which are not numbered (see BackgroundCell)
+
+bool TLandscape::ClassCell(int c, long k, TCell& cell) const
+{
+ long pos = freecells.Cell(c,k);
+ if (pos < 0)
+   return false;
+ raster.PositionCell(pos, cell.x, cell.y);
+ return true;
 }
 
 //---------------------------------------------------------------------------
@@ -412,15 +859,28 @@ double TLandscape::CalculateOptimalFitness ()
  TCell start(xmax/2,ymax/2);
  THomeRange homerange;
 
- mfree[start.x][start.y]=-1;
+ OccupyCell(start);
  homerange.push_back(start);
  ExpandHomeRange(homerange);
  TCell hrcenter = HomeRangeCenter(homerange);
- double d = 0;
- for (THomeRange::iterator i=homerange.begin();
-      i!=homerange.end(); i++)
-         d+=EvaluatePoint(*i,hrcenter);
- return d;
+ return HomeRangeFitness(homerange,hrcenter);
+}
+
+//---------------------------------------------------------------------------
+// OptimalFitness: fitness of the best possible home range in an empty uniform landscape of nrows x ncols cells
+// (see CalculateOptimalFitness), which depends only on the home range size, the distance weight and the storage
+// The home range grows from the center and never reaches farther than hrsize cells from it, so each dimension of
+// the uniform landscape is bounded by 2*hrsize+1 without changing the result.
+// The value is calculated again for each simulation and not kept between them: the growth of the home range breaks
+// ties with the random generator of the simulator, so skipping it would change the random numbers of the simulation.
+
+double TLandscape::OptimalFitness(TSimulator* simulator, int nrows, int ncols)
+{
+ int bound = 2*simulator->GetHomeRangeSize()+1;
+
+ // in the optimal landscape all cells have habitat affinity 1
+ TLandscape landscapeopt(simulator,1,MIN(nrows,bound),MIN(ncols,bound));
+ return landscapeopt.CalculateOptimalFitness();
 }
 
 //---------------------------------------------------------------------------
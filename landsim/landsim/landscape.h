@@ -1,15 +1,21 @@
 #ifndef _LANDSCAPE_H_
 #define _LANDSCAPE_H_
 
-#include <list>
+#include <vector>
 
 #include "nrtypes.h"
+#include "raster.h"
+#include "freecells.h"
+#include "blockindex.h"
+#include "frontier.h"
+#include "walkindex.h"
+#include "randomstream.h"
+#include "workerpool.h"
 
 using namespace std;
 
 class TSimulator;
-class TIndividual;
-typedef list<TIndividual> TPopulation;
+class StochasticLib1;
 
 struct TCell
 {
@@ -23,8 +29,7 @@ bool operator==(const TCell& c1, const TCell& c2);
 bool operator<(const TCell& c1, const TCell& c2);
 ostream& operator<<(ostream& s, const TCell& c);
 
-typedef list<TCell> THomeRange;
-typedef list<TCell> TNeighbors;
+typedef vector<TCell> THomeRange;   // cells of a home range, in the order in which they were added
 
 ostream& operator<<(ostream& s, const THomeRange& hr);
 
@@ -32,28 +37,70 @@ class TLandscape
 {
  public:
    TLandscape(TSimulator*, Mat_DP*);
+   TLandscape(TSimulator*, const string&);
    TLandscape(TSimulator*, double, int, int);
    ~TLandscape();
-   Mat_DP& GetLandscapeMatrix() {return mland;}
-   const Mat_DP& GetLandscapeMatrix() const {return mland;}
+   const TRaster& GetRaster() const {return raster;}
    bool PlaceHomeRange(THomeRange&, TCell&);
-   void Update(const TPopulation&);
+   void ReleaseHomeRange(const THomeRange&);
+   void ReleaseHomeRange(const TCell* cells, unsigned int n);
+   bool PlaceCell(long& cell, TCell&);
+   long PlaceCells(long n, vector<long>& cells);
+   void Walk(int n, TCell* cells, int8_t* arrived);
+   bool PlaceHomeRangeAt(THomeRange&, TCell& hrcentermother, const TCell& start);
+   bool PlaceCellAt(long& cell, const TCell& start);
+   void Speculate(int n, const TCell* mothers, TCell* starts, int8_t* found, TRandomStream* streams,
+                  TRandomStream* growth, int nthreads);
+   bool Confirm(int k, TCell& start, bool found, const TCell& mother, TRandomStream& rnd);
+   bool PlaceHomeRangeAt(int k, THomeRange&, TCell& hrcentermother, const TCell& start, TRandomStream& growth);
+   double CellFitness(long cell);
+   int NClasses() const {return freecells.NClasses();}
+   long ClassCells(int c) const {return freecells.Count(c);}
+   double ClassFitness(int c) const;
+   bool ClassCell(int c, long k, TCell&) const;
+   TCell BackgroundCell(StochasticLib1*) const;
+   long BackgroundCells() const {return freecells.CountBackground();}
+   TCell BackgroundCell(long k) const;
+   void Update();
    double EvaluatePoint (const TCell& pt, const TCell& ctr);
+   double HomeRangeFitness(const THomeRange&, const TCell& ctr);
    TCell HomeRangeCenter(const THomeRange&);
    double CalculateOptimalFitness();
+   static double OptimalFitness(TSimulator*, int nrows, int ncols);
+   long CellIndex(const TCell& c) const {return long(c.x)*ymax + c.y;}
+   TCell IndexCell(long cell) const {return TCell(int(cell/ymax), int(cell%ymax));}
  private:
    bool ChooseStartingPoint(TCell&, TCell&);
    bool ChooseStartingPointMode0(TCell&);
    bool ChooseStartingPointMode1(TCell&, TCell&);
    bool ChooseStartingPointMode2(TCell&, TCell&);
+   template<class R> bool KernelSearch(TCell&, const TCell& mother, R& rnd, TDiskQuery&) const;
+   template<class R> bool RandomWalk(TCell&, const TCell& start, int steps, R& rnd, TCell* path) const;
+   void SpeculateRange(int first, int last, const TCell* mothers, TCell* starts, int8_t* found, TRandomStream* streams,
+                       TRandomStream* growth);
    bool ExpandHomeRange(THomeRange&);
-   void CalculateNeighbors(THomeRange&, TNeighbors&);
-   TCell ChoosePoint(const THomeRange& homerange, TNeighbors& neighbors);
+   template<class R> bool GrowHomeRange(THomeRange&, TFrontier&, R& rnd, bool speculate);
+   void CalculateNeighbors(const TCell& last, const TCell& ctr, TFrontier&);
+   template<class R> TCell ChoosePoint(TFrontier&, R& rnd);
+   void OccupyCell(const TCell&);
+   void FreeCell(const TCell&);
+   void StoreTile(const TCell&);
 
    int xmax;
    int ymax;
-   Mat_DP mland;     // a matrix of the landscape with each cell having an affinity value (between 0 and 1)
-   Mat_DP mfree;     // a matrix where the occupied cells have value -1, only free cells have the correct affinity
+   TRaster raster;            // affinity (between 0 and 1) and occupancy of each cell
+   TFreeCellIndex freecells;  // free cells grouped by affinity, kept in step with the raster
+   TBlockIndex blocks;        // block summaries of the free cells for searches in the dispersal kernel
+   TDiskQuery query;          // the search in the dispersal kernel of the juvenile being settled
+   TFrontier frontier;        // free cells next to the home range being expanded, with their values
+   TWalkIndex walks;          // transitions of the random walk from each cell, only built for dispersal mode 2
+   vector<TWalker> walkers;   // random walks running in lockstep
+   double snapaffty;          // maximum affinity of the free cells when the juveniles of Speculate searched
+   vector<TCell> paths;       // cells where each step of their walks began, with neighbor avoidance
+   vector<vector<long> > grown;   // cells read by the growth of their home ranges: the home range, then the frontier
+   vector<int> grownsize;     // size of these home ranges
+   TWorkerPool workers;       // threads of Speculate, kept from batch to batch
+   THomeRange abandoned;  // cells claimed by home ranges that could not be completed, released in the next Update
    TSimulator* simulator;
 };
 
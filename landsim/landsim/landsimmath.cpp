@@ -77,6 +77,8 @@ void CSimulPop(
  TSimParam param;
  param.land = new Mat_DP(land,dims[0],dims[1]);
         // stores the landscape passed from Mathematica with dims[0] rows and dims[1] columns
+ WSReleaseRealArray(stdlink, land, dims, heads, d);
+        // the array from Mathematica is not needed after the copy
  param.initpopulation = initpopulation;
  param.nsteps = nsteps;
  param.hrsize = hrsize;
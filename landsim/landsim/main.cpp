@@ -1,10 +1,20 @@
+#include <stdlib.h>
 #include "simulator.h"
 
 int main (int argc, char * const argv[]) {
 
 		TSimParam param;
 		
-		param.land = new Mat_DP(.5,10,10);
+		if (argc > 1)
+			param.landfile = argv[1];	// raster file with the landscape (see TRasterHeader in raster.h)
+		else param.land = new Mat_DP(.5,10,10);
+		if (argc > 2)
+			param.threads = atoi(argv[2]);	// threads of the settlement of dispersal modes 1 and 2 (see simulator.h)
+		if (param.threads < 0)
+			{
+			cerr << "The number of threads " << argv[2] << " is negative...\n...now exiting to system...\n";
+			exit(1);
+			}
 		cout << "initpopulation:\n";
 		cin >> param.initpopulation;
 		cout << "nsteps:\n";
@@ -70,6 +70,177 @@ inline void SWAP(T &a, T &b)
 #include <valarray>
 #define NRVec valarray
 
+/* ---------------------------------------------------
+   Aligned storage and vectorized kernels used by NRMat
+   ---------------------------------------------------
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const int NR_ALIGN = 64;   // rows of NRMat start at cache line boundaries
+
+// number of elements between row starts so that every row is aligned
+template<class T>
+inline int NRStride(int m)
+{
+ if (NR_ALIGN % sizeof(T) != 0)
+   return m;
+ int k = NR_ALIGN / sizeof(T);
+ return (m + k - 1) / k * k;
+}
+
+// allocates n default-initialized elements aligned to NR_ALIGN bytes
+template<class T>
+T* NRAlloc(size_t n)
+{
+ if (n == 0)
+   return 0;
+ void* p = 0;
+#ifdef _MSC_VER
+ p = _aligned_malloc(n * sizeof(T), NR_ALIGN);
+ if (p == 0)
+   throw bad_alloc();
+#else
+ if (posix_memalign(&p, NR_ALIGN, n * sizeof(T)) != 0)
+   throw bad_alloc();
+#endif
+ T* a = static_cast<T*>(p);
+ for (size_t i=0; i<n; i++)
+   new (a+i) T;
+ return a;
+}
+
+template<class T>
+void NRFree(T* a, size_t n)
+{
+ if (a == 0)
+   return;
+ for (size_t i=0; i<n; i++)
+   a[i].~T();
+#ifdef _MSC_VER
+ _aligned_free(a);
+#else
+ free(a);
+#endif
+}
+
+// row kernels: generic versions and vectorized versions for doubles (AVX, SSE2 or scalar fallback)
+
+template<class T>
+inline T NRRowMax(const T* a, int n, T x)
+{
+ for (int i=0; i<n; i++)
+   if (x < a[i]) x=a[i];
+ return x;
+}
+
+template<class T>
+inline T NRRowMin(const T* a, int n, T x)
+{
+ for (int i=0; i<n; i++)
+   if (x > a[i]) x=a[i];
+ return x;
+}
+
+template<class T>
+inline void NRRowFill(T* a, int n, const T& x)
+{
+ fill(a, a+n, x);
+}
+
+template<class T>
+inline void NRRowCopy(T* a, const T* b, int n)
+{
+ copy(b, b+n, a);   // becomes a memmove for arithmetic types
+}
+
+inline double NRRowMax(const double* a, int n, double x)
+{
+ int i=0;
+#if defined(__AVX__)
+ __m256d m0 = _mm256_set1_pd(x), m1 = m0;
+ for (; i+8<=n; i+=8)
+   {
+   m0 = _mm256_max_pd(m0, _mm256_loadu_pd(a+i));
+   m1 = _mm256_max_pd(m1, _mm256_loadu_pd(a+i+4));
+   }
+ double t[4];
+ _mm256_storeu_pd(t, _mm256_max_pd(m0, m1));
+ x = MAX(MAX(t[0],t[1]), MAX(t[2],t[3]));
+#elif defined(__SSE2__)
+ __m128d m0 = _mm_set1_pd(x), m1 = m0;
+ for (; i+4<=n; i+=4)
+   {
+   m0 = _mm_max_pd(m0, _mm_loadu_pd(a+i));
+   m1 = _mm_max_pd(m1, _mm_loadu_pd(a+i+2));
+   }
+ double t[2];
+ _mm_storeu_pd(t, _mm_max_pd(m0, m1));
+ x = MAX(t[0],t[1]);
+#endif
+ for (; i<n; i++)
+   if (x < a[i]) x=a[i];
+ return x;
+}
+
+inline double NRRowMin(const double* a, int n, double x)
+{
+ int i=0;
+#if defined(__AVX__)
+ __m256d m0 = _mm256_set1_pd(x), m1 = m0;
+ for (; i+8<=n; i+=8)
+   {
+   m0 = _mm256_min_pd(m0, _mm256_loadu_pd(a+i));
+   m1 = _mm256_min_pd(m1, _mm256_loadu_pd(a+i+4));
+   }
+ double t[4];
+ _mm256_storeu_pd(t, _mm256_min_pd(m0, m1));
+ x = MIN(MIN(t[0],t[1]), MIN(t[2],t[3]));
+#elif defined(__SSE2__)
+ __m128d m0 = _mm_set1_pd(x), m1 = m0;
+ for (; i+4<=n; i+=4)
+   {
+   m0 = _mm_min_pd(m0, _mm_loadu_pd(a+i));
+   m1 = _mm_min_pd(m1, _mm_loadu_pd(a+i+2));
+   }
+ double t[2];
+ _mm_storeu_pd(t, _mm_min_pd(m0, m1));
+ x = MIN(t[0],t[1]);
+#endif
+ for (; i<n; i++)
+   if (x > a[i]) x=a[i];
+ return x;
+}
+
+inline void NRRowFill(double* a, int n, const double& x)
+{
+ int i=0;
+#if defined(__AVX__)
+ __m256d v = _mm256_set1_pd(x);
+ for (; i+4<=n; i+=4)
+   _mm256_storeu_pd(a+i, v);
+#elif defined(__SSE2__)
+ __m128d v = _mm_set1_pd(x);
+ for (; i+2<=n; i+=2)
+   _mm_storeu_pd(a+i, v);
+#endif
+ for (; i<n; i++)
+   a[i] = x;
+}
+
+inline void NRRowCopy(double* a, const double* b, int n)
+{
+ memcpy(a, b, n*sizeof(double));
+}
+
 /* ---------------------------------------------------
    Class NRMat
    ---------------------------------------------------
@@ -80,7 +251,9 @@ class NRMat {
    private:
       int nn;
       int mm;
-      T** v;
+      int ss;  // stride: distance between the starts of consecutive rows, mm rounded up to whole cache lines
+      T* v;    // contiguous storage of nn rows of ss elements, aligned to NR_ALIGN bytes
+      void allocate(int n, int m);
    public:
       NRMat();
       NRMat(int n, int m); // Zero-based array
@@ -94,6 +267,9 @@ class NRMat {
       inline const T* operator[](const int i) const;
       inline int nrows() const;
       inline int ncols() const;
+      inline int stride() const;
+      inline T* data();
+      inline const T* data() const;
      //My extensions
  //     valarray<T>& array() { valarray(v[0],mm*nn); }
       //Overloaded operators
@@ -180,62 +356,53 @@ inline float atan2 (double x, float y) {return atan2(x,double(y));}
 */
 
 template <class T>
-NRMat<T>::NRMat() : nn(0), mm(0), v(0) {}
+void NRMat<T>::allocate(int n, int m)
+{
+ nn = n;
+ mm = m;
+ ss = NRStride<T>(m);
+ v = NRAlloc<T>(size_t(n)*ss);
+}
+
+template <class T>
+NRMat<T>::NRMat() : nn(0), mm(0), ss(0), v(0) {}
 
 template <class T>
-NRMat<T>::NRMat(int n, int m) : nn(n), mm(m), v(new T*[n])
+NRMat<T>::NRMat(int n, int m)
 {
- v[0] = new T[m*n];
- for (int i=1; i< n; i++)
-   v[i] = v[i-1] + m;
+ allocate(n,m);
 }
 
 template <class T>
-NRMat<T>::NRMat(const T &a, int n, int m) : nn(n), mm(m), v(new T*[n])
+NRMat<T>::NRMat(const T &a, int n, int m)
 {
- int i,j;
- v[0] = new T[m*n];
- for (i=1; i< n; i++)
-   v[i] = v[i-1] + m;
- for (i=0; i< n; i++)
-   for (j=0; j<m; j++)
-      v[i][j] = a;
+ allocate(n,m);
+ for (int i=0; i< n; i++)
+   NRRowFill(v+size_t(i)*ss, m, a);
 }
 
 template <class T>
-NRMat<T>::NRMat(const T *a, int n, int m) : nn(n), mm(m), v(new T*[n])
+NRMat<T>::NRMat(const T *a, int n, int m)
 {
- int i,j;
- v[0] = new T[m*n];
- for (i=1; i< n; i++)
-   v[i] = v[i-1] + m;
- for (i=0; i< n; i++)
-   for (j=0; j<m; j++)
-      v[i][j] = *a++;
+ allocate(n,m);
+ for (int i=0; i< n; i++)
+   NRRowCopy(v+size_t(i)*ss, a+size_t(i)*m, m);
 }
 
 template <class T>
-NRMat<T>::NRMat(T **a, int n, int m) : nn(n), mm(m), v(new T*[n])
+NRMat<T>::NRMat(T **a, int n, int m)
 {
- int i,j;
- v[0] = new T[m*n];
- for (i=1; i< n; i++)
-   v[i] = v[i-1] + m;
- for (i=0; i< n; i++)
-   for (j=0; j<m; j++)
-      v[i][j] = a[i][j];
+ allocate(n,m);
+ for (int i=0; i< n; i++)
+   NRRowCopy(v+size_t(i)*ss, a[i], m);
 }
 
 template <class T>
-NRMat<T>::NRMat(const NRMat &rhs) : nn(rhs.nn), mm(rhs.mm), v(new T*[nn])
+NRMat<T>::NRMat(const NRMat &rhs)
 {
- int i,j;
- v[0] = new T[mm*nn];
- for (i=1; i< nn; i++)
-   v[i] = v[i-1] + mm;
- for (i=0; i< nn; i++)
-   for (j=0; j<mm; j++)
-      v[i][j] = rhs[i][j];
+ allocate(rhs.nn,rhs.mm);
+ for (int i=0; i< nn; i++)
+   NRRowCopy(v+size_t(i)*ss, rhs[i], mm);
 }
 
 template <class T>
@@ -245,22 +412,12 @@ NRMat<T> & NRMat<T>::operator=(const NRMat<T> &rhs)
 // has been resized to match the size of rhs
 {
  if (this != &rhs) {
-   int i,j;
    if (nn != rhs.nn || mm != rhs.mm) {
-      if (v != 0) {
-         delete[] (v[0]);
-         delete[] (v);
-         }
-      nn=rhs.nn;
-      mm=rhs.mm;
-      v = new T*[nn];
-      v[0] = new T[mm*nn];
+      NRFree(v, size_t(nn)*ss);
+      allocate(rhs.nn,rhs.mm);
       }
-   for (i=1; i< nn; i++)
-      v[i] = v[i-1] + mm;
-   for (i=0; i< nn; i++)
-      for (j=0; j<mm; j++)
-         v[i][j] = rhs[i][j];
+   for (int i=0; i< nn; i++)
+      NRRowCopy(v+size_t(i)*ss, rhs[i], mm);
    }
  return *this;
 }
@@ -269,21 +426,20 @@ template <class T>
 NRMat<T> & NRMat<T>::operator=(const T &a) //assign a to every element
 {
  for (int i=0; i< nn; i++)
-   for (int j=0; j<mm; j++)
-      v[i][j] = a;
+   NRRowFill(v+size_t(i)*ss, mm, a);
  return *this;
 }
 
 template <class T>
 inline T* NRMat<T>::operator[](const int i) //subscripting: pointer to row i
 {
- return v[i];
+ return v+size_t(i)*ss;
 }
 
 template <class T>
 inline const T* NRMat<T>::operator[](const int i) const
 {
- return v[i];
+ return v+size_t(i)*ss;
 }
 
 template <class T>
@@ -298,12 +454,30 @@ inline int NRMat<T>::ncols() const
  return mm;
 }
 
+template <class T>
+inline int NRMat<T>::stride() const
+{
+ return ss;
+}
+
+template <class T>
+inline T* NRMat<T>::data()
+{
+ return v;
+}
+
+template <class T>
+inline const T* NRMat<T>::data() const
+{
+ return v;
+}
+
 template <class T>
 NRMat<T> & NRMat<T>::operator-()
 {
   for (int i=0; i< nn; i++)
    for (int j=0; j<mm; j++)
-      v[i][j] = - v[i][j];
+      (*this)[i][j] = - (*this)[i][j];
  return *this;
 }
 
@@ -312,7 +486,7 @@ NRMat<T> & NRMat<T>::operator+=(const T &a)
 {
  for (int i=0; i< nn; i++)
    for (int j=0; j<mm; j++)
-      v[i][j] += a;
+      (*this)[i][j] += a;
  return *this;
 }
 
@@ -321,39 +495,34 @@ NRMat<T> & NRMat<T>::operator-=(const T &a)
 {
  for (int i=0; i< nn; i++)
    for (int j=0; j<mm; j++)
-      v[i][j] -= a;
+      (*this)[i][j] -= a;
  return *this;
 }
 
 template <class T>
 T NRMat<T>::max() const
 {
- T x = v[0][0];
+ T x = v[0];
 
  for (int i=0; i< nn; i++)
-   for (int j=0; j<mm; j++)
-      if (x < v[i][j]) x=v[i][j];
+   x = NRRowMax((*this)[i], mm, x);
  return x;
 }
 
 template <class T>
 T NRMat<T>::min() const
 {
- T x = v[0][0];
+ T x = v[0];
 
  for (int i=0; i< nn; i++)
-   for (int j=0; j<mm; j++)
-      if (x > v[i][j]) x=v[i][j];
+   x = NRRowMin((*this)[i], mm, x);
  return x;
 }
 
 template <class T>
 NRMat<T>::~NRMat()
 {
- if (v != 0) {
-   delete[] (v[0]);
-   delete[] (v);
-   }
+ NRFree(v, size_t(nn)*ss);
 }
 
 /* ---------------------------------------------------
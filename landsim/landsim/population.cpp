@@ -0,0 +1,406 @@
+#include <algorithm>
+#include "population.h"
+#include "simulator.h"
+
+
+// Constructor of TPopulation: it is run when the population is created, with no individuals
+
+TPopulation::TPopulation(TSimulator* simulatorIn)
+{
+ simulator = simulatorIn;
+ landscape = simulator->GetLandscape();
+ hrsize = simulator->GetHomeRangeSize();
+}
+
+
+// Settle: selects a home range in the landscape for each juvenile, brood by brood
+// The juveniles that settle are added at the end of the population, the others (floaters) die
+
+void TPopulation::Settle(const TJuveniles& juveniles)
+{
+ // with global dispersal single cell home ranges do not depend on the mother, all the juveniles settle at once
+ if (hrsize==1 && (simulator->GetDispersalMode()==0 || simulator->GetStep()==1))
+   {
+   long n = 0;
+   for (TJuveniles::const_iterator i=juveniles.begin(); i!=juveniles.end(); i++)
+     n += i->count;
+   SettleGlobal(n);
+   return;
+   }
+
+ // the searches of local dispersal run at the same time in several threads
+ if ((simulator->GetDispersalMode()==1 || simulator->GetDispersalMode()==2) && simulator->GetStep()>1 &&
+     simulator->GetThreads()>0)
+   {
+   SettleSpeculative(juveniles);
+   return;
+   }
+
+ // walks that do not depend on occupancy run in lockstep
+ if (simulator->GetDispersalMode()==2 && simulator->GetStep()>1 && simulator->GetWalkers()>1 &&
+     simulator->GetNeighAvoidance()==0)
+   {
+   SettleWalkers(juveniles);
+   return;
+   }
+
+ for (TJuveniles::const_iterator i=juveniles.begin(); i!=juveniles.end(); i++)
+   for (int n=0; n<i->count; n++)
+     Settle(i->hrcentermother);
+}
+
+
+// Settle: selects a home range in the landscape for a juvenile born in hrcentermother
+// If it settles it is added at the end of the population, otherwise it dies (floater)
+
+void TPopulation::Settle(TCell hrcentermother)
+{
+ if (hrsize==1)   // single cell home range: no list of cells and no expansion
+   {
+   long cell;
+   if (landscape->PlaceCell(cell,hrcentermother))
+     AddCell(cell);
+   return;
+   }
+
+ homerange.clear();
+ if (landscape->PlaceHomeRange(homerange,hrcentermother))   // tries to setlle a home-range
+   AddHomeRange();
+}
+
+
+// Settle: as Settle for a juvenile born in hrcentermother whose dispersal ended in start (see SettleWalkers and
+// SettleSpeculative)
+
+void TPopulation::Settle(TCell hrcentermother, const TCell& start)
+{
+ if (hrsize==1)
+   {
+   long cell;
+   if (landscape->PlaceCellAt(cell,start))
+     AddCell(cell);
+   return;
+   }
+
+ homerange.clear();
+ if (landscape->PlaceHomeRangeAt(homerange,hrcentermother,start))
+   AddHomeRange();
+}
+
+
+// SettleGlobal: selects a single cell home range for n juveniles with global dispersal, in a single pass
+// over the cells placed by TLandscape::PlaceCells. The juveniles that settle are added at the end of the
+// population as in Settle, the others (floaters) die
+
+void TPopulation::SettleGlobal(long n)
+{
+ settled.clear();
+ landscape->PlaceCells(n, settled);
+ for (vector<long>::const_iterator i=settled.begin(); i!=settled.end(); i++)
+   AddCell(*i);
+}
+
+
+// SettleWalkers: selects a home range for each juvenile with the random walks of dispersal mode 2 in lockstep
+// The walks of batches of simulator->GetWalkers() juveniles run together (see TLandscape::Walk), and then
+// the juveniles of the batch settle one by one in order as in Settle. A walk does not see the juveniles of its batch
+// that settle before it, so this is only done when the walks do not depend on occupancy (no neighbor avoidance)
+
+void TPopulation::SettleWalkers(const TJuveniles& juveniles)
+{
+ int batch = simulator->GetWalkers();
+ ends.resize(batch);
+ arrived.resize(batch);
+
+ TJuveniles::const_iterator i = juveniles.begin();
+ int done = 0;   // juveniles of the brood i already in a batch
+ int n;
+ while ((n = Batch(juveniles, i, done, batch)) > 0)
+   {
+   copy(mothers.begin(), mothers.begin()+n, ends.begin());
+   landscape->Walk(n, &ends[0], &arrived[0]);
+   for (int k=0; k<n; k++)
+     if (arrived[k])
+       Settle(mothers[k], ends[k]);
+   }
+}
+
+
+// SettleSpeculative: selects a home range for each juvenile with local dispersal in two phases, for batches of
+// BATCHSIZE juveniles, or fewer with larger home ranges. First the juveniles of the batch search for a starting cell
+// at the same time in simulator->GetThreads() threads, in the landscape as it was before the batch (see
+// TLandscape::Speculate). Then they settle one by one in order as in Settle, and the searches that the juveniles
+// settled before have changed are checked, and done again if needed (see TLandscape::Confirm), so that each juvenile
+// gets a cell with the same probabilities as in Settle. Home ranges of more than one cell also grow at the same time
+// from the cells found, and only grow again when the juveniles settled before changed what they read (see
+// TLandscape::PlaceHomeRangeAt). The batches are smaller with larger home ranges, so that their home ranges cover
+// about the same area, which keeps the growths that the juveniles of a batch change (and the work of a batch) about
+// the same.
+// Each juvenile searches with a random stream of its own, numbered by its place among the juveniles of the step,
+// and its home range grows with another, numbered in the same way from the complement of the seed. So the results
+// do not depend on the number of threads, but the random numbers are not those of Settle.
+
+void TPopulation::SettleSpeculative(const TJuveniles& juveniles)
+{
+ int batch = MAX(64, BATCHSIZE/int(hrsize));
+ ends.resize(batch);
+ arrived.resize(batch);
+ streams.resize(batch);
+ growth.resize(batch);
+
+ // the seed of the streams of the step, 64 bits in two draws
+ uint64_t seed = simulator->sto->BRandom();
+ seed = (seed << 32) | simulator->sto->BRandom();
+
+ TJuveniles::const_iterator i = juveniles.begin();
+ int done = 0;    // juveniles of the brood i already in a batch
+ long first = 0;  // juveniles of the step in the batches before
+ int n;
+ while ((n = Batch(juveniles, i, done, batch)) > 0)
+   {
+   for (int k=0; k<n; k++)
+     {
+     streams[k].Init(seed, first+k);
+     growth[k].Init(~seed, first+k);
+     }
+   landscape->Speculate(n, &mothers[0], &ends[0], &arrived[0], &streams[0], (hrsize>1) ? &growth[0] : NULL,
+                        simulator->GetThreads());
+   for (int k=0; k<n; k++)
+     if (landscape->Confirm(k, ends[k], arrived[k]!=0, mothers[k], streams[k]))
+       {
+       if (hrsize==1)
+         Settle(mothers[k], ends[k]);
+       else
+         {
+         homerange.clear();
+         if (landscape->PlaceHomeRangeAt(k, homerange, mothers[k], ends[k], growth[k]))
+           AddHomeRange();
+         }
+       }
+   first += n;
+   }
+}
+
+
+// Batch: puts in mothers the home-range centers of the mothers of the next juveniles, at most size of them, and
+// returns how many. The next juvenile is the juvenile done of the brood i, and both are updated.
+
+int TPopulation::Batch(const TJuveniles& juveniles, TJuveniles::const_iterator& i, int& done, int size)
+{
+ mothers.resize(size);
+ int n = 0;
+ while (n<size && i!=juveniles.end())
+   if (done==i->count)
+     {
+     i++;
+     done = 0;
+     }
+   else
+     {
+     mothers[n] = i->hrcentermother;
+     n++;
+     done++;
+     }
+ return n;
+}
+
+
+// AddCell: adds an individual with a home range of a single cell, given as CellIndex
+
+void TPopulation::AddCell(long cell)
+{
+ TCell hrcenter = landscape->IndexCell(cell);
+ double d = landscape->CellFitness(cell);
+ d *= simulator->GetBirthRate();
+ d /= simulator->GetOptimalFitness();
+ Add(hrcenter,d);
+ cells.push_back(hrcenter);
+}
+
+
+// AddHomeRange: adds an individual with the home range just settled in homerange
+// The home range does not change while the individual lives, so the fitness is calculated only once:
+// the fitness (energy yield) of the home range multiplied by fecundity (b0 in the model)
+// and normalized by the optimal home-range fitness (Phi in the model)
+
+void TPopulation::AddHomeRange()
+{
+ TCell hrcenter = landscape->HomeRangeCenter(homerange);     // calculates the center of the HR
+ double d = landscape->HomeRangeFitness(homerange,hrcenter);
+ d *= simulator->GetBirthRate();
+ d /= simulator->GetOptimalFitness();
+ Add(hrcenter,d);
+ cells.insert(cells.end(), homerange.begin(), homerange.end());
+}
+
+
+// Add: adds an individual with age zero at the end of the population, its home-range cells are added by the caller
+
+void TPopulation::Add(const TCell& ctr, double fit)
+{
+ age.push_back(0);
+ fitness.push_back(fit);
+ center.push_back(ctr);
+}
+
+
+// Move: copies individual from to the position to, which is before it
+
+void TPopulation::Move(long from, long to)
+{
+ age[to] = age[from];
+ fitness[to] = fitness[from];
+ center[to] = center[from];
+ copy(cells.begin()+from*hrsize, cells.begin()+(from+1)*hrsize, cells.begin()+to*hrsize);
+}
+
+
+// Resize: keeps the first n individuals
+
+void TPopulation::Resize(long n)
+{
+ age.resize(n);
+ fitness.resize(n);
+ center.resize(n);
+ cells.resize(n*hrsize);
+}
+
+
+// OutputHomeRanges: writes a list of the list of home range cells of each individual in a Mathematica format
+
+void TPopulation::OutputHomeRanges(ostream& os)
+{
+ for (long k=0; k<Size(); k++)
+    {
+    const TCell* hr = GetHomeRange(k);
+    os << '{';
+    for (unsigned int j=0; j<hrsize; j++)
+      {
+      os << hr[j];
+      if (j!=hrsize-1)
+        os << ',';
+      }
+    os << '}';
+    if (k!=Size()-1)
+      os << ",\n";
+    }
+}
+
+
+// OutputAges: writes a list of the individual ages in a Mathematica format
+
+void TPopulation::OutputAges(ostream& os)
+{
+ for (long k=0; k<Size(); k++)
+   {
+   os << age[k];
+   if (k!=Size()-1)
+     os << ", ";
+   }
+}
+
+
+// ApplyJuvenileMortality: kills juveniles randomly and removes them (first stage of juvenile mortality)
+// Each juvenile survives as an adult in CalculateSurvival, so the survivors of a brood are a binomial draw with the number of juveniles
+
+void TPopulation::ApplyJuvenileMortality(TJuveniles& juveniles)
+{
+ if (simulator->GetSurvival()>=1.0)   // Deterministic simulation: juveniles (age 0) survive
+   return;
+ long n = 0;   // number of broods with survivors
+ for (long k=0; k<long(juveniles.size()); k++)
+   {
+   int count = simulator->sto->Binomial(juveniles[k].count, simulator->GetSurvival());
+   if (count>0)
+     {
+     juveniles[n] = juveniles[k];
+     juveniles[n++].count = count;
+     }
+   }
+ juveniles.erase(juveniles.begin()+n, juveniles.end());
+}
+
+
+// ApplyBreedingAndMortality: increases the age of each individual and produces its offspring in a given year,
+// then kills adults randomly, releases their cells and removes them from the population (adult mortality)
+// The number of offspring and the survival of all the individuals are drawn first, in two batches,
+// and then the juveniles are stored and the dead removed in a single pass over the population
+// The offspring of each individual are stored in juveniles as a brood
+
+void TPopulation::ApplyBreedingAndMortality(TJuveniles& juveniles)
+{
+ for (long k=0; k<Size(); k++)
+   age[k]++;  // Increase the age of the individual (a reproductive season has happened)
+ CalculateOffspring();  // Calculates the number of offspring based on the home range
+ CalculateSurvival();
+
+ long n = 0;   // number of survivors
+ for (long k=0; k<Size(); k++)
+   {
+   if (offspring[k]>0)
+     juveniles.push_back(TBrood(center[k],offspring[k]));
+
+   if (!survives[k])
+     landscape->ReleaseHomeRange(GetHomeRange(k), hrsize);  // cells opened by adult mortality
+   else
+     {
+     if (n!=k)
+       Move(k,n);
+     n++;
+     }
+   }
+ Resize(n);
+}
+
+// CalculateOffspring: calculates the number of offspring of each individual in a given year
+
+void TPopulation::CalculateOffspring()
+{
+ offspring.resize(Size());
+ if (simulator->GetSurvival()>=1.0)      // Deterministic simulation
+   {
+   for (long k=0; k<Size(); k++)
+     if (age[k] >= simulator->GetBreedingAge())  // if age is greater than breeding age
+       offspring[k] = iround(fitness[k]);     // The number of offspring equals the fecundity
+     else offspring[k] = 0;                  // if individual has not reached breeding age
+   return;
+   }
+
+ // The number of offspring is a Poisson with mean equal to fecundity,
+ // and zero (with no random number drawn) if individual has not reached breeding age
+ lambda.resize(Size());
+ for (long k=0; k<Size(); k++)
+   lambda[k] = (age[k] >= simulator->GetBreedingAge()) ? fitness[k] : 0;
+ if (Size()>0)
+   simulator->sto->Poisson(&offspring[0], &lambda[0], Size());
+}
+
+// CalculateSurvival: determines whether each individual survives, either stochastically or deterministically
+
+void TPopulation::CalculateSurvival()
+{
+ survives.resize(Size());
+ if (simulator->GetSurvival()>=1.0) // Deterministic simulation: deterministic death
+   {
+   for (long k=0; k<Size(); k++)
+     survives[k] = (age[k] < simulator->GetSurvival());  // survives if age smaller than maximum age
+   return;
+   }
+ // Stochastic simulation: survives if Bernouli event with probability simulator->GetSurvival() is true
+ if (Size()>0)
+   simulator->sto->Bernoulli(&survives[0], simulator->GetSurvival(), Size());
+}
+
+
+// iround: Helper function that rounds a real number to the nearest integer
+int iround(double x)
+{
+    double dum;
+    if (fabs(modf(x,&dum))==0.5)
+    {
+        if (int(floor(x))%2==0)
+            return floor(x);
+        else return ceil(x);
+    }
+    return floor(x+.5);
+}
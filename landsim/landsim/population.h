@@ -0,0 +1,78 @@
+#ifndef _POPULATION_H_
+#define _POPULATION_H_
+
+#include <vector>
+#include <ostream>
+#include "landscape.h"
+
+using namespace std;
+
+class TSimulator;
+
+// TPopulation: the individuals that hold a home range (the settlers), stored as arrays of their attributes
+// Individual k has age age[k], fitness fitness[k] and home-range center center[k]. All home ranges have the home range
+// size, so the home range of individual k is the hrsize cells of cells starting at k*hrsize. The dead are removed by
+// compacting the arrays in order and the settled juveniles are appended at the end, so that the individuals are always
+// in the order in which they settled.
+// Juveniles have no home range yet: the offspring of each mother are kept as a brood, the home-range center of the
+// mother and the number of juveniles, and only become individuals if they settle.
+
+struct TBrood
+{
+ TCell hrcentermother;
+ int count;
+ TBrood(const TCell& ctr, int n): hrcentermother(ctr), count(n) {};
+};
+
+typedef vector<TBrood> TJuveniles;
+
+class TPopulation
+{
+ public:
+         TPopulation(TSimulator*);
+         long Size() const {return long(age.size());}
+         unsigned int GetAge(long k) const {return age[k];}
+         const TCell* GetHomeRange(long k) const {return &cells[k*hrsize];}
+         void ApplyBreedingAndMortality(TJuveniles&);
+         void ApplyJuvenileMortality(TJuveniles&);
+         void Settle(const TJuveniles&);
+         void OutputHomeRanges(ostream&);
+         void OutputAges(ostream&);
+ private:
+         void Settle(TCell hrcentermother);
+         void Settle(TCell hrcentermother, const TCell& start);
+         void SettleGlobal(long n);
+         void SettleWalkers(const TJuveniles&);
+         void SettleSpeculative(const TJuveniles&);
+         int Batch(const TJuveniles&, TJuveniles::const_iterator& i, int& done, int size);
+         void AddCell(long cell);
+         void AddHomeRange();
+         void CalculateOffspring();
+         void CalculateSurvival();
+         void Add(const TCell& ctr, double fit);
+         void Move(long from, long to);
+         void Resize(long n);
+
+         TSimulator* simulator;
+         TLandscape* landscape;
+         unsigned int hrsize;
+         vector<unsigned int> age;
+         vector<double> fitness;   // expected number of offspring per breeding season, fixed when the home range is settled
+         vector<TCell> center;     // home-range centers
+         vector<TCell> cells;      // home-range cells, hrsize per individual
+         THomeRange homerange;     // home range being settled
+         vector<long> settled;     // cells settled at once with global dispersal (see SettleGlobal)
+         static const int BATCHSIZE = 1024;   // juveniles that search at the same time in SettleSpeculative, with home ranges of one cell
+         vector<TCell> mothers;    // home-range centers of the mothers of the juveniles of a batch (see Batch)
+         vector<TCell> ends;       // last cells of their walks, or starting cells of their searches
+         vector<int8_t> arrived;   // whether their walks ended, or their searches found a cell
+         vector<TRandomStream> streams;   // random streams of the juveniles that search at the same time
+         vector<TRandomStream> growth;    // and of the growth of their home ranges
+         vector<int32_t> offspring;  // number of offspring of each individual in the current step
+         vector<int8_t> survives;    // survival of each individual in the current step
+         vector<double> lambda;      // expected number of offspring of each individual in the current step
+};
+
+int iround(double x);
+
+#endif
@@ -70,29 +70,33 @@ void CRandomMersenne::RandomInitByArray(int const seeds[], int NumSeeds) {
 }
 
 
-uint32_t CRandomMersenne::BRandom() {
-   // Generate 32 random bits
+void CRandomMersenne::Generate() {
+   // Generate MERS_N words at one time
+   const uint32_t LOWER_MASK = (1LU << MERS_R) - 1;       // Lower MERS_R bits
+   const uint32_t UPPER_MASK = 0xFFFFFFFF << MERS_R;      // Upper (32 - MERS_R) bits
+   static const uint32_t mag01[2] = {0, MERS_A};
    uint32_t y;
 
-   if (mti >= MERS_N) {
-      // Generate MERS_N words at one time
-      const uint32_t LOWER_MASK = (1LU << MERS_R) - 1;       // Lower MERS_R bits
-      const uint32_t UPPER_MASK = 0xFFFFFFFF << MERS_R;      // Upper (32 - MERS_R) bits
-      static const uint32_t mag01[2] = {0, MERS_A};
+   int kk;
+   for (kk=0; kk < MERS_N-MERS_M; kk++) {    
+      y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
+      mt[kk] = mt[kk+MERS_M] ^ (y >> 1) ^ mag01[y & 1];}
 
-      int kk;
-      for (kk=0; kk < MERS_N-MERS_M; kk++) {    
-         y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
-         mt[kk] = mt[kk+MERS_M] ^ (y >> 1) ^ mag01[y & 1];}
+   for (; kk < MERS_N-1; kk++) {    
+      y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
+      mt[kk] = mt[kk+(MERS_M-MERS_N)] ^ (y >> 1) ^ mag01[y & 1];}      
 
-      for (; kk < MERS_N-1; kk++) {    
-         y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
-         mt[kk] = mt[kk+(MERS_M-MERS_N)] ^ (y >> 1) ^ mag01[y & 1];}      
+   y = (mt[MERS_N-1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
+   mt[MERS_N-1] = mt[MERS_M-1] ^ (y >> 1) ^ mag01[y & 1];
+   mti = 0;
+}
 
-      y = (mt[MERS_N-1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
-      mt[MERS_N-1] = mt[MERS_M-1] ^ (y >> 1) ^ mag01[y & 1];
-      mti = 0;
-   }
+
+uint32_t CRandomMersenne::BRandom() {
+   // Generate 32 random bits
+   uint32_t y;
+
+   if (mti >= MERS_N) Generate();
    y = mt[mti++];
 
    // Tempering (May be omitted):
@@ -105,6 +109,28 @@ uint32_t CRandomMersenne::BRandom() {
 }
 
 
+void CRandomMersenne::BRandom(uint32_t * destination, int n) {
+   // Generate n times 32 random bits, the same as n calls to BRandom().
+   // The words left in the state are tempered in one loop without
+   // branches, which the compiler can vectorize, before generating more.
+   while (n > 0) {
+      if (mti >= MERS_N) Generate();
+      int m = MERS_N - mti;
+      if (m > n) m = n;
+      const uint32_t * w = mt + mti;
+      for (int i = 0; i < m; i++) {
+         uint32_t y = w[i];
+         y ^=  y >> MERS_U;
+         y ^= (y << MERS_S) & MERS_B;
+         y ^= (y << MERS_T) & MERS_C;
+         y ^=  y >> MERS_L;
+         destination[i] = y;
+      }
+      mti += m;  destination += m;  n -= m;
+   }
+}
+
+
 double CRandomMersenne::Random() {
    // Output random float number in the interval 0 <= x < 1
    // Multiply by 2^(-32)
@@ -0,0 +1,30 @@
+#ifndef _RANDOMSTREAM_H_
+#define _RANDOMSTREAM_H_
+
+#include <stdint.h>
+
+// TRandomStream: a small random number generator for the juveniles that disperse in parallel (see
+// TLandscape::Speculate), with the members of the random library that dispersal uses
+// Each juvenile has its own stream, numbered by its place among the juveniles of the step, so that the cell it
+// finds does not depend on the thread that searched for it. The generator is SplitMix64, with 8 bytes of state that
+// are seeded in constant time from the seed of the step and the number of the stream.
+
+class TRandomStream
+{
+ public:
+   void Init(uint64_t seed, uint64_t stream) {state = Mix(seed ^ Mix(stream));}
+   double Random() {return (Next() >> 11) * (1.0/9007199254740992.0);}   // uniform in [0,1[
+   int IRandom(int min, int max) {return min + int(((Next() >> 32) * uint64_t(max-min+1)) >> 32);}
+ private:
+   uint64_t Next() {return Mix(state += 0x9E3779B97F4A7C15ULL);}
+   static uint64_t Mix(uint64_t z)
+     {
+     z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+     z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+     return z ^ (z >> 31);
+     }
+
+   uint64_t state;
+};
+
+#endif
@@ -0,0 +1,510 @@
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "raster.h"
+
+
+// RasterError: reports an error in a raster file and exits, as the Numerical Recipes error handler
+
+static void RasterError(const string& filename, const string& error_text)
+{
+ cerr << "Raster file " << filename << ": " << error_text << endl;
+ cerr << "...now exiting to system..." << endl;
+ exit(1);
+}
+
+
+// Constructor of TRaster: creates an empty raster
+
+TRaster::TRaster() : xmax(0), ymax(0), storage(DenseStorage), layout(RowMajorLayout), rowstride(0), tilesy(0),
+                     npositions(0), wide(false), code8(0), code16(0), sinkcode(-1), value64(0), value32(0),
+                     backcode(-1), mapping(0), mapsize(0)
+{
+}
+
+
+// Destructor of TRaster: unmaps the raster file, if any
+
+TRaster::~TRaster()
+{
+ Unmap();
+}
+
+
+// Unmap: releases the mapped raster file, if any
+
+void TRaster::Unmap()
+{
+ if (mapping)
+   munmap(mapping, mapsize);
+ mapping = 0;
+ mapsize = 0;
+ code8 = 0;
+ code16 = 0;
+ value64 = 0;
+ value32 = 0;
+}
+
+
+// Build: stores the landscape land with the given storage mode (see TLandStorage) and layout (see TLandLayout, only
+// used in compact storage)
+// and marks all cells as free
+
+void TRaster::Build(const Mat_DP& land, int storageIn, int layoutIn)
+{
+ Unmap();
+ xmax = land.nrows();
+ ymax = land.ncols();
+ storage = (storageIn==MappedStorage) ? DenseStorage : storageIn;   // mapped storage needs a file
+ // dense storage is always row major and sparse storage always tiled (see TRaster)
+ if (storage==DenseStorage)
+   layout = RowMajorLayout;
+ else layout = (storage==SparseStorage || layoutIn==TiledLayout) ? TiledLayout : RowMajorLayout;
+ bool compact = (storage!=DenseStorage);
+ backcode = -1;
+ tiles.clear();
+
+ // size of the storage: rows padded like the rows of a matrix of doubles, or whole tiles
+ int tilesx = (xmax + 7) / 8;
+ tilesy = (ymax + 7) / 8;
+ rowstride = NRStride<double>(ymax);
+ long ncells = (layout==RowMajorLayout) ? long(xmax) * rowstride : long(tilesx) * tilesy * 64;
+
+ // finds the distinct affinity values in decreasing order and how many cells have each, skipping runs of equal values
+ // in compact storage the affinities are floats, so values that are equal as floats are the same class
+ map<double,int,greater<double> > values;
+ map<double,int,greater<double> >::iterator last = values.end();
+ for (int i=0; i<xmax; i++)
+   for (int j=0; j<ymax; j++)
+     {
+     double a = compact ? double(float(land[i][j])) : land[i][j];
+     if (last==values.end() || last->first!=a)
+       last = values.insert(make_pair(a,0)).first;
+     last->second++;
+     }
+
+ classaffty.clear();
+ for (map<double,int,greater<double> >::iterator v=values.begin(); v!=values.end(); v++)
+   if (v->first >= 0)
+     classaffty.push_back(v->first);
+
+ if (!compact)
+   {
+   mland = land;
+   mfree = mland;
+   npositions = long(mland.nrows()) * mland.stride();
+   return;
+   }
+
+ // the background of sparse storage is the most frequent value that is sink or nodata
+ double background = 1;
+ int nbackground = 0;
+ for (map<double,int,greater<double> >::iterator v=values.begin(); v!=values.end(); v++)
+   if (v->first <= 0 && v->second > nbackground)
+     {
+     background = v->first;
+     nbackground = v->second;
+     }
+
+ codeaffty.clear();
+ sinkcode = -1;
+
+ if (values.size() <= 65536)
+   {
+   // one code per distinct value, in decreasing order so that the codes of the classes come first
+   for (map<double,int,greater<double> >::iterator v=values.begin(); v!=values.end(); v++)
+     {
+     v->second = int(codeaffty.size());
+     codeaffty.push_back(float(v->first));
+     }
+   }
+ else
+   {
+   // too many values for 16 bit codes: quantizes the non negative affinities in 65535 levels between their
+   // minimum and maximum, all negative affinities become a single code with value -1
+   // An affinity of exactly 0 (sink) keeps a level of its own, the last one, and the positive affinities are quantized
+   // in the other levels, so that no habitat cell becomes a sink.
+   int levels = 65535;
+   bool sink = (classaffty.back()==0);
+   int n = sink ? levels-1 : levels;     // levels of the quantized affinities
+   double hi = classaffty.front();
+   double lo = classaffty[classaffty.size() - (sink ? 2 : 1)];
+   classaffty.clear();
+   for (int k=0; k<n; k++)
+     {
+     float a = (k==n-1) ? float(lo) : float(hi - k*(hi-lo)/(n-1));
+     codeaffty.push_back(a);
+     classaffty.push_back(a);
+     }
+   if (sink)
+     {
+     codeaffty.push_back(0);
+     classaffty.push_back(0);
+     }
+   codeaffty.push_back(-1);
+   for (map<double,int,greater<double> >::iterator v=values.begin(); v!=values.end(); v++)
+     if (v->first < 0)
+       v->second = levels;
+     else if (v->first == 0)
+       v->second = levels-1;
+     else v->second = int(floor((hi-v->first)/(hi-lo)*(n-1) + 0.5));
+   }
+
+ for (int c=0; c<int(classaffty.size()); c++)
+   {
+   classaffty[c] = codeaffty[c];     // the affinity of a class is exactly the affinity of its code
+   if (codeaffty[c]==0)
+     sinkcode = c;
+   }
+ codeclass.assign(codeaffty.size(), -1);
+ for (int c=0; c<int(classaffty.size()); c++)
+   codeclass[c] = c;
+
+ wide = (codeaffty.size() > 256);
+ codes8.clear();
+ codes16.clear();
+ if (storage==SparseStorage)
+   {
+   BuildTiles(land, values, (nbackground > 0) ? values[background] : -1, background);
+   return;
+   }
+ if (wide)
+   codes16.resize(ncells);
+ else codes8.resize(ncells);
+ for (int i=0; i<xmax; i++)
+   for (int j=0; j<ymax; j++)
+     {
+     int c = values[double(float(land[i][j]))];
+     if (wide)
+       codes16[Index(i,j)] = uint16_t(c);
+     else codes8[Index(i,j)] = uint8_t(c);
+     }
+ code8 = wide ? 0 : &codes8[0];
+ code16 = wide ? &codes16[0] : 0;
+
+ npositions = ncells;
+ occupied.assign((ncells + 63) / 64, 0);
+}
+
+
+// BuildTiles: stores in sparse storage the tiles of land with some cell whose code is not the background code
+// values gives the code of each affinity value (as a float) and backvalue is the affinity of the background code
+// The matrix is dense, so its cells are compared once with the background value, and only the cells of the tiles
+// in the list of tiles with habitat are coded.
+
+void TRaster::BuildTiles(const Mat_DP& land, map<double,int,greater<double> >& values, int background, double backvalue)
+{
+ backcode = background;
+ tilesy = (ymax + 7) / 8;
+ npositions = 0;
+ occupied.clear();
+ tiles.clear();
+ tilehash.Clear();
+
+ vector<long> habitat;   // tiles with some cell that is not background, in the order of the cells
+ for (int i=0; i<xmax; i++)
+   for (int j=0; j<ymax; j++)
+     {
+     long tile = long(i>>3)*tilesy + (j>>3);
+     if (!habitat.empty() && habitat.back()==tile)
+       continue;
+     double a = double(float(land[i][j]));
+     if (backcode >= 0 && (a==backvalue || values[a]==backcode))
+       continue;
+     habitat.push_back(tile);
+     }
+ sort(habitat.begin(), habitat.end());
+ habitat.erase(unique(habitat.begin(), habitat.end()), habitat.end());
+
+ int tilesx = (xmax + 7) / 8;
+ sorted = habitat;
+ rowtiles.assign(tilesx+1, 0);
+ rowbackground.assign(tilesx+1, 0);
+ for (int k=0; k<int(habitat.size()); k++)
+   {
+   AddTile(habitat[k]);
+   int x0 = int(habitat[k]/tilesy)*8;
+   int y0 = int(habitat[k]%tilesy)*8;
+   for (int i=x0; i<MIN(x0+8,xmax); i++)
+     for (int j=y0; j<MIN(y0+8,ymax); j++)
+       {
+       int c = values[double(float(land[i][j]))];
+       if (wide)
+         codes16[Index(i,j)] = uint16_t(c);
+       else codes8[Index(i,j)] = uint8_t(c);
+       }
+   rowtiles[x0/8+1]++;
+   rowbackground[x0/8+1] -= long(MIN(8,xmax-x0)) * MIN(8,ymax-y0);
+   }
+
+ // adds up the counts of the rows before each row of tiles
+ for (int tx=0; tx<tilesx; tx++)
+   {
+   rowtiles[tx+1] += rowtiles[tx];
+   rowbackground[tx+1] += rowbackground[tx] + long(MIN(8,xmax-tx*8)) * ymax;
+   }
+}
+
+
+// AddTile: adds a tile to sparse storage with all its cells free and background, returns its position in tiles
+
+int TRaster::AddTile(long tile)
+{
+ int slot = int(tiles.size());
+ tiles.push_back(tile);
+ tilehash.Insert(tile, slot);
+ npositions += 64;
+ if (wide)
+   {
+   codes16.resize(npositions, uint16_t(backcode));
+   code16 = &codes16[0];
+   }
+ else
+   {
+   codes8.resize(npositions, uint8_t(backcode));
+   code8 = &codes8[0];
+   }
+ occupied.push_back(0);
+ return slot;
+}
+
+
+// StoreTile: adds to sparse storage the background tile of cell (x,y) and removes its cells from the counts of
+// background cells. Returns the position of (x,y)
+
+long TRaster::StoreTile(int x, int y)
+{
+ long tile = long(x>>3)*tilesy + (y>>3);
+ AddTile(tile);
+ sorted.insert(upper_bound(sorted.begin(), sorted.end(), tile), tile);
+ int x0 = (x>>3)*8;
+ int y0 = (y>>3)*8;
+ for (int tx=x0/8+1; tx<int(rowtiles.size()); tx++)
+   {
+   rowtiles[tx]++;
+   rowbackground[tx] -= long(MIN(8,xmax-x0)) * MIN(8,ymax-y0);
+   }
+ return Index(x,y);
+}
+
+
+// UnstoredCell: stops when a cell of a background tile is occupied before its tile is stored, as the indexes of free
+// cells would keep counting it with the background cells (see TLandscape::OccupyCell)
+
+void TRaster::UnstoredCell(int x, int y) const
+{
+ cerr << "Cell (" << x << "," << y << ") of a background tile is occupied before its tile is stored" << endl;
+ cerr << "...now exiting to system..." << endl;
+ exit(1);
+}
+
+
+// AnyStored: whether some cell of the rectangle [x0,x1[ x [y0,y1[ has its own storage
+// Only sparse storage has cells without storage, the cells of the background tiles
+
+bool TRaster::AnyStored(int x0, int y0, int x1, int y1) const
+{
+ if (storage!=SparseStorage)
+   return true;
+ for (int tx=x0>>3; tx<=(x1-1)>>3; tx++)
+   for (int ty=y0>>3; ty<=(y1-1)>>3; ty++)
+     if (tilehash.Find(long(tx)*tilesy + ty) >= 0)
+       return true;
+ return false;
+}
+
+
+// BackgroundCell: returns in (x,y) the k-th cell of the background tiles, k in [0,BackgroundCells()-1]
+// The cells are numbered tile by tile, in the order of the tiles and of their cells. The row of tiles is found by a
+// binary search of the counts of background cells before each row, and the tile in the row by a binary search of the
+// stored tiles of the row: before the i-th of them there are its column minus i background tiles.
+
+void TRaster::BackgroundCell(long k, int& x, int& y) const
+{
+ int tx = int(upper_bound(rowbackground.begin(), rowbackground.end(), k) - rowbackground.begin()) - 1;
+ k -= rowbackground[tx];
+ int x0 = tx*8;
+ int w = MIN(8, xmax-x0);
+ long t = k / (w*8);            // the tile is the t-th background tile of the row, all before it have w*8 cells
+ int lo = rowtiles[tx];
+ int hi = rowtiles[tx+1];
+ while (lo < hi)
+   {
+   int mid = (lo + hi) / 2;
+   if (sorted[mid] - long(tx)*tilesy - (mid - rowtiles[tx]) <= t)
+     lo = mid + 1;
+   else hi = mid;
+   }
+ int y0 = int(t + lo - rowtiles[tx])*8;
+ int h = MIN(8, ymax-y0);
+ int j = int(k - t*w*8);
+ x = x0 + j/h;
+ y = y0 + j%h;
+}
+
+
+// Finite: whether a value is a number, not infinite nor NaN (the difference of infinities and NaNs is NaN)
+
+static inline bool Finite(double a)
+{
+ return a - a == 0;
+}
+
+
+// DenseClass: returns the class of an affinity value in dense storage, -1 if the value is negative (or NaN)
+
+int TRaster::DenseClass(double affinity) const
+{
+ if (!(affinity >= 0))
+   return -1;
+ return int(lower_bound(classaffty.begin(), classaffty.end(), affinity, greater<double>()) - classaffty.begin());
+}
+
+
+// Map: maps a raster file (see TRasterHeader) read only and uses its payload in place, without copying it
+// Float payloads are read in mapped storage and code payloads in compact storage, always in row major layout
+// The file is little endian and is read in place, so it can only be mapped on a little endian machine. Files with
+// values that are not finite numbers (NaN or infinite) are rejected, as they have no place in the classes.
+// Float payloads are read once at load to find their classes, and files with more than 65536 distinct affinities
+// are rejected, so that the classes take bounded memory; such landscapes have to be quantized into a code payload.
+
+void TRaster::Map(const string& filename)
+{
+ Unmap();
+ const uint16_t one = 1;
+ if (*(const uint8_t*)&one != 1)
+   RasterError(filename, "cannot be mapped on a big endian machine, raster files are little endian");
+ int fd = open(filename.c_str(), O_RDONLY);
+ if (fd < 0)
+   RasterError(filename, "cannot be opened");
+ struct stat st;
+ if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(TRasterHeader)))
+   RasterError(filename, "has no header");
+ mapsize = size_t(st.st_size);
+ mapping = mmap(0, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+ close(fd);             // the mapping stays valid
+ if (mapping == MAP_FAILED)
+   {
+   mapping = 0;
+   RasterError(filename, "cannot be mapped");
+   }
+
+ TRasterHeader header;
+ memcpy(&header, mapping, sizeof(header));
+ if (memcmp(header.magic, "LSRASTER", 8) != 0)
+   RasterError(filename, "is not a raster file");
+ if (header.version == 0x01000000)   // version 1 with its bytes swapped
+   RasterError(filename, "is big endian, raster files are little endian");
+ if (header.version != 1)
+   RasterError(filename, "is not a raster file of version 1");
+ size_t valuesize[4] = {sizeof(double), sizeof(float), sizeof(uint8_t), sizeof(uint16_t)};
+ if (header.type > RasterUInt16)
+   RasterError(filename, "has an unknown type of values");
+ // the dimensions fit in an int, so the number of cells fits in 62 bits, but not its size in bytes
+ if (header.nrows == 0 || header.ncols == 0 || header.nrows > 0x7FFFFFFF || header.ncols > 0x7FFFFFFF ||
+     header.nrows * header.ncols > (~uint64_t(0) - sizeof(TRasterHeader)) / valuesize[header.type] ||
+     uint64_t(mapsize) != sizeof(TRasterHeader) + header.nrows * header.ncols * valuesize[header.type])
+   RasterError(filename, "has a payload that does not match its dimensions");
+ if (header.type <= RasterFloat32 && !(header.nodata < 0))
+   RasterError(filename, "has a float payload with a nodata value that is not negative");
+ if (header.type >= RasterUInt8 && !(Finite(header.scale) && Finite(header.offset)))
+   RasterError(filename, "has a scale or an offset that is not a finite number");
+
+ xmax = int(header.nrows);
+ ymax = int(header.ncols);
+ layout = RowMajorLayout;
+ rowstride = ymax;
+ tilesy = 0;
+ mland = Mat_DP();
+ mfree = Mat_DP();
+ codes8.clear();
+ codes16.clear();
+ const char* payload = (const char*)mapping + sizeof(TRasterHeader);
+ long ncells = long(xmax) * ymax;
+ npositions = ncells;
+ backcode = -1;
+ tiles.clear();
+
+ if (header.type >= RasterUInt8)
+   MapCodes(header, payload);
+ else
+   {
+   storage = MappedStorage;
+   if (header.type == RasterFloat64)
+     value64 = (const double*)payload;
+   else value32 = (const float*)payload;
+
+   // finds the distinct affinity values in decreasing order, skipping runs of equal values
+   map<double,int,greater<double> > values;
+   double last = -1;
+   for (long i=0; i<ncells; i++)
+     {
+     double a = Value(i);
+     if (!Finite(a))
+       RasterError(filename, "has a value that is not a finite number");
+     if (a != last && a >= 0)
+       {
+       values[a] = 0;
+       last = a;
+       if (values.size() > 65536)
+         RasterError(filename, "has more than 65536 distinct affinities, which need a code payload (RasterUInt16)");
+       }
+     }
+   classaffty.clear();
+   for (map<double,int,greater<double> >::iterator v=values.begin(); v!=values.end(); v++)
+     classaffty.push_back(v->first);
+   }
+
+ occupied.assign((ncells + 63) / 64, 0);
+}
+
+
+// MapCodes: uses the codes of a mapped payload in compact storage, the affinity of code v being offset + scale*v
+
+void TRaster::MapCodes(const TRasterHeader& header, const void* payload)
+{
+ storage = CompactStorage;
+ wide = (header.type == RasterUInt16);
+ int ncodes = wide ? 65536 : 256;
+ if (wide)
+   code16 = (const uint16_t*)payload;
+ else code8 = (const uint8_t*)payload;
+
+ // only the codes present in the payload become classes
+ long ncells = long(xmax) * ymax;
+ vector<char> present(ncodes, 0);
+ for (long i=0; i<ncells; i++)
+   present[Code(i)] = 1;
+
+ codeaffty.resize(ncodes);
+ map<double,int,greater<double> > values;
+ for (int v=0; v<ncodes; v++)
+   {
+   codeaffty[v] = (v == header.nodata) ? -1 : float(header.offset + header.scale*v);
+   if (present[v] && codeaffty[v] >= 0)
+     values[codeaffty[v]] = 0;
+   }
+
+ classaffty.clear();
+ for (map<double,int,greater<double> >::iterator v=values.begin(); v!=values.end(); v++)
+   {
+   v->second = int(classaffty.size());
+   classaffty.push_back(v->first);
+   }
+
+ codeclass.assign(ncodes, -1);
+ sinkcode = -1;
+ for (int v=0; v<ncodes; v++)
+   if (present[v])
+     {
+     if (codeaffty[v] >= 0)
+       codeclass[v] = values[codeaffty[v]];
+     if (codeaffty[v] == 0)
+       sinkcode = v;
+     }
+}
@@ -0,0 +1,292 @@
+#ifndef _RASTER_H_
+#define _RASTER_H_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <stdint.h>
+
+#include "nrtypes.h"
+#include "tilehash.h"
+
+using namespace std;
+
+// Storage modes of the landscape
+enum TLandStorage
+{
+ DenseStorage = 0,     // affinity and free cells as matrices of doubles (16 bytes per cell)
+ CompactStorage = 1,   // affinity as 8 or 16 bit class codes and occupancy as a bitset (1 to 2 bytes per cell)
+ MappedStorage = 2,    // affinity read in place from a mapped raster file and occupancy as a bitset (set by Map)
+ SparseStorage = 3     // as compact, but only the tiles of 8x8 cells that are not all sink or nodata are stored
+};
+
+// Layouts of the cells in memory
+enum TLandLayout
+{
+ RowMajorLayout = 0,   // row by row, as in a matrix
+ TiledLayout = 1       // tiles of 8x8 cells, each tile stored contiguously (compact and sparse storages)
+};
+
+// Types of the values in the payload of a raster file
+enum TRasterType
+{
+ RasterFloat64 = 0,    // affinities as doubles
+ RasterFloat32 = 1,    // affinities as floats
+ RasterUInt8 = 2,      // 8 bit codes, the affinity of code v is offset + scale*v
+ RasterUInt16 = 3      // 16 bit codes, as RasterUInt8
+};
+
+// Raster files: a header of 64 bytes followed by the payload, all numbers little endian
+//    bytes  0-7   "LSRASTER"
+//    bytes  8-11  version of the format (1), 32 bit integer
+//    bytes 12-15  type of the values of the payload (see TRasterType), 32 bit integer
+//    bytes 16-23  number of rows, 64 bit integer
+//    bytes 24-31  number of columns, 64 bit integer
+//    bytes 32-39  nodata, double
+//    bytes 40-47  scale, double (codes only)
+//    bytes 48-55  offset, double (codes only)
+//    bytes 56-63  zero
+// The payload has the value of each cell, row by row without padding. In float payloads the values are the
+// affinities, all finite numbers, and nodata has to be negative, as cells with negative affinity are never free. In code payloads
+// the cells with code nodata have no habitat (affinity -1). From Mathematica a landscape land is written with
+//    f = OpenWrite[name, BinaryFormat -> True]; BinaryWrite[f, "LSRASTER"];
+//    BinaryWrite[f, {1, 0}, "UnsignedInteger32"]; BinaryWrite[f, Dimensions[land], "UnsignedInteger64"];
+//    BinaryWrite[f, {-1., 1., 0., 0.}, "Real64"]; BinaryWrite[f, Flatten[land], "Real64"]; Close[f]
+// Map reads the file in place: the operating system loads the pages of the payload when they are first used
+// and can drop them again under memory pressure. Code payloads are the format for rasters larger than the memory:
+// float payloads are also read in place, but Map reads all of them once at load to find their classes, and accepts
+// at most 65536 distinct affinities (larger sets have to be quantized into codes first). In both cases the occupancy
+// bits and the index of the free cells of TLandscape still take memory for every cell (about 8 bytes).
+
+struct TRasterHeader
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t type;
+   uint64_t nrows;
+   uint64_t ncols;
+   double nodata;
+   double scale;
+   double offset;
+   uint64_t reserved;
+};
+
+// TRaster: habitat affinity and occupancy of the cells of the landscape
+// The affinity values are numbered in classes by decreasing value; cells with negative affinity are never free
+// and have class -1. In dense storage the exact affinities are kept in mland and the occupied cells are -1 in mfree.
+// In compact storage each cell keeps the code of its class, the affinity of each code is a float, and the
+// occupied cells are set bits. Landscapes with more than 65536 distinct values are quantized in 65536 levels.
+// The payload of a mapped raster file (see Map) is not copied: float payloads are read in mapped storage, with the
+// occupied cells as a bitset, and code payloads are used as the codes of compact storage.
+// Sparse storage keeps the codes and occupancy of compact storage for the tiles of 8x8 cells that have habitat, found
+// through a hash of the tile numbers. The other tiles are all background, the most frequent value that is sink (0)
+// or nodata (negative), so that memory and the scans of the indexes scale with the area of habitat. A background
+// tile is stored when one of its cells is first occupied (see StoreTile). The cells of the background tiles are
+// numbered tile by tile, and the count of background cells before each row of tiles finds one of them from its number
+// (see BackgroundCell).
+// Compact storage places the cells in memory according to the layout (see TLandLayout and Index), dense storage and
+// mapped files are always row major and sparse storage is tiled. A tile of 8x8 codes of 8 bits is one cache line,
+// so its neighbors are in the same or in nearby lines, which matters when the raster does not fit in the cache.
+// A tile of doubles spans eight lines and gains nothing, so dense storage keeps the rows of the matrices.
+
+class TRaster
+{
+ public:
+   TRaster();
+   ~TRaster();
+   void Build(const Mat_DP& land, int storage, int layout);
+   void Map(const string& filename);
+   int nrows() const {return xmax;}
+   int ncols() const {return ymax;}
+   bool Compact() const {return storage==CompactStorage || storage==SparseStorage;}
+   bool Sparse() const {return storage==SparseStorage;}
+   inline double Affinity(int x, int y) const;
+   inline float AffinityF(int x, int y) const;
+   inline bool IsSink(int x, int y) const;      // affinity 0
+   inline bool IsFree(int x, int y) const;
+   inline double FreeAffinity(int x, int y) const;   // affinity of a free cell, -1 if occupied
+   inline void Occupy(int x, int y);                 // in sparse storage the cell has to be stored (see StoreTile)
+   inline void Release(int x, int y);
+   inline int Class(int x, int y) const;
+   int NClasses() const {return int(classaffty.size());}
+   double ClassAffinity(int c) const {return classaffty[c];}
+   // positions of the cells in the storage, for indexes that keep data per cell
+   long Position(int x, int y) const {return Index(x,y);}   // -1 for the cells of background tiles
+   inline void PositionCell(long pos, int& x, int& y) const;   // cell at a position, the inverse of Position
+   long Positions() const {return npositions;}
+   // sparse storage
+   bool Stored(int x, int y) const {return Index(x,y) >= 0;}
+   bool AnyStored(int x0, int y0, int x1, int y1) const;   // whether some cell of the rectangle is stored
+   long StoreTile(int x, int y);                          // stores the background tile of (x,y), returns its position
+   int NTiles() const {return int(tiles.size());}
+   void TileOrigin(int k, int& x, int& y) const {x = int(tiles[k]/tilesy)*8; y = int(tiles[k]%tilesy)*8;}
+   double BackgroundAffinity() const {return (backcode < 0) ? -1 : codeaffty[backcode];}
+   int BackgroundClass() const {return (backcode < 0) ? -1 : codeclass[backcode];}
+   long BackgroundCells() const {return (storage==SparseStorage) ? rowbackground.back() : 0;}
+   void BackgroundCell(long k, int& x, int& y) const;     // the k-th cell of the background tiles
+ private:
+   TRaster(const TRaster&);              // not copied, it may own a mapped file
+   TRaster& operator=(const TRaster&);
+   inline long Index(int x, int y) const;
+   int AddTile(long tile);
+   void BuildTiles(const Mat_DP& land, map<double,int,greater<double> >& values, int background, double backvalue);
+   void UnstoredCell(int x, int y) const;
+   int Code(long i) const {return (i < 0) ? backcode : wide ? code16[i] : code8[i];}
+   double Value(long i) const {return value64 ? value64[i] : value32[i];}
+   bool Occupied(long i) const {return i >= 0 && ((occupied[i>>6] >> (i&63)) & 1);}
+   int DenseClass(double affinity) const;
+   void MapCodes(const TRasterHeader& header, const void* payload);
+   void Unmap();
+
+   int xmax;
+   int ymax;
+   int storage;
+   int layout;
+   int rowstride;                   // cells between the starts of two rows in the row major layout
+   int tilesy;                      // number of tiles along y in the tiled layouts and in sparse storage
+   long npositions;                 // size of the storage in cells
+   vector<double> classaffty;       // affinity of each class of cells that can be free, in decreasing order
+   // dense storage
+   Mat_DP mland;     // a matrix of the landscape with each cell having an affinity value (between 0 and 1)
+   Mat_DP mfree;     // a matrix where the occupied cells have value -1, only free cells have the correct affinity
+   // compact storage
+   bool wide;                       // codes stored in 16 bits instead of 8
+   const uint8_t* code8;            // codes of the cells, in codes8 or in the mapped file
+   const uint16_t* code16;
+   vector<uint8_t> codes8;
+   vector<uint16_t> codes16;
+   vector<float> codeaffty;         // affinity of each code
+   vector<int> codeclass;           // class of each code, -1 for negative affinities
+   int sinkcode;                    // code of affinity 0, -1 if there are no sink cells
+   // mapped storage
+   const double* value64;           // affinities of the cells in the mapped file, one of them is used
+   const float* value32;
+   // sparse storage
+   int backcode;                    // code of the cells of the tiles that are not stored, -1 if all are stored
+   vector<long> tiles;              // tile number (x/8 * tilesy + y/8) of each stored tile, in storage order
+   TTileHash tilehash;              // position in tiles of each stored tile
+   vector<long> sorted;             // the stored tiles in increasing order
+   vector<int> rowtiles;            // place in sorted of the first stored tile of each row of tiles, and the total
+   vector<long> rowbackground;      // cells of the background tiles before each row of tiles, and the total
+   // compact, mapped and sparse storages
+   vector<uint64_t> occupied;       // one bit per cell
+   void* mapping;                   // mapped raster file, 0 if none
+   size_t mapsize;
+};
+
+
+// Index: position of cell (x,y) in the storage of the raster
+// The row major layout of dense storage is tested first, so that it only pays one predictable test
+inline long TRaster::Index(int x, int y) const
+{
+ if (layout==RowMajorLayout)
+   return long(x)*rowstride + y;
+ long tile = long(x>>3)*tilesy + (y>>3);
+ if (storage==SparseStorage)
+   tile = tilehash.Find(tile);
+ return (tile < 0) ? -1 : (tile << 6) | ((x&7)<<3) | (y&7);
+}
+
+inline void TRaster::PositionCell(long pos, int& x, int& y) const
+{
+ if (layout==RowMajorLayout)
+   {
+   x = int(pos/rowstride);
+   y = int(pos%rowstride);
+   return;
+   }
+ long tile = (storage==SparseStorage) ? tiles[pos>>6] : pos>>6;
+ x = int(tile/tilesy)*8 + int((pos>>3)&7);
+ y = int(tile%tilesy)*8 + int(pos&7);
+}
+
+inline double TRaster::Affinity(int x, int y) const
+{
+ switch (storage)
+   {
+   case CompactStorage:
+   case SparseStorage: return codeaffty[Code(Index(x,y))];
+   case MappedStorage: return Value(Index(x,y));
+   }
+ return mland.data()[Index(x,y)];
+}
+
+inline float TRaster::AffinityF(int x, int y) const
+{
+ switch (storage)
+   {
+   case CompactStorage:
+   case SparseStorage: return codeaffty[Code(Index(x,y))];
+   case MappedStorage: return float(Value(Index(x,y)));
+   }
+ return float(mland.data()[Index(x,y)]);
+}
+
+inline bool TRaster::IsSink(int x, int y) const
+{
+ switch (storage)
+   {
+   case CompactStorage:
+   case SparseStorage: return Code(Index(x,y))==sinkcode;
+   case MappedStorage: return Value(Index(x,y))==0;
+   }
+ return mland.data()[Index(x,y)]==0;
+}
+
+inline bool TRaster::IsFree(int x, int y) const
+{
+ long i = Index(x,y);
+ switch (storage)
+   {
+   case CompactStorage:
+   case SparseStorage: return !Occupied(i) && codeclass[Code(i)] >= 0;
+   case MappedStorage: return !Occupied(i) && Value(i) >= 0;
+   }
+ return mfree.data()[i] >= 0;
+}
+
+inline double TRaster::FreeAffinity(int x, int y) const
+{
+ long i = Index(x,y);
+ switch (storage)
+   {
+   case CompactStorage:
+   case SparseStorage: return Occupied(i) ? -1 : codeaffty[Code(i)];
+   case MappedStorage: return Occupied(i) ? -1 : Value(i);
+   }
+ return mfree.data()[i];
+}
+
+inline void TRaster::Occupy(int x, int y)
+{
+ long i = Index(x,y);
+ if (i < 0)           // a cell of a background tile in sparse storage, its tile has to be stored first
+   UnstoredCell(x,y);
+ if (storage==DenseStorage)
+   mfree.data()[i] = -1;
+ else occupied[i>>6] |= uint64_t(1) << (i&63);
+}
+
+inline void TRaster::Release(int x, int y)
+{
+ long i = Index(x,y);
+ if (i < 0)           // background cells are never occupied
+   return;
+ if (storage==DenseStorage)
+   mfree.data()[i] = mland.data()[i];
+ else occupied[i>>6] &= ~(uint64_t(1) << (i&63));
+}
+
+inline int TRaster::Class(int x, int y) const
+{
+ switch (storage)
+   {
+   case CompactStorage:
+   case SparseStorage: return codeclass[Code(Index(x,y))];
+   case MappedStorage: return DenseClass(Value(Index(x,y)));
+   }
+ return DenseClass(mland.data()[Index(x,y)]);
+}
+
+#endif
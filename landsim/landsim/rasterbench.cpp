@@ -0,0 +1,151 @@
+/*************************** rasterbench.cpp *******************************
+* Project: LandSim
+*
+* Description:
+* Benchmark of the memory layouts of TRaster (see TLandLayout in raster.h).
+* Times the two access patterns of the simulation that touch neighboring
+* cells: the 4-neighborhood lookups of the random walk in
+* TLandscape::ChooseStartingPointMode2, for one walker at a time and for
+* many walkers advancing in turn, and the 8-neighborhood lookups of
+* TLandscape::CalculateNeighbors, on a landscape of habitat classes with
+* roads. The locality gain of the tiled layout shows up in compact storage
+* when the raster is larger than the last level cache. Dense storage is
+* always row major, so it is only timed as a reference.
+*
+* Instructions:
+* This file is not part of the landsim target. Compile it for console mode
+* together with raster.cpp, for instance
+*    g++ -O2 -o rasterbench rasterbench.cpp raster.cpp
+* and run it with the number of rows and columns of the landscape and the
+* storage mode (0 dense, 1 compact):
+*    ./rasterbench 6000 6000 0
+*****************************************************************************/
+
+#include <cstdlib>
+#include <ctime>
+#include "raster.h"
+
+// xorshift generator, so that the benchmark does not depend on the random library
+static uint32_t rndstate = 2463534242u;
+inline uint32_t Rnd()
+{
+ rndstate ^= rndstate << 13;
+ rndstate ^= rndstate >> 17;
+ rndstate ^= rndstate << 5;
+ return rndstate;
+}
+
+// Walk: random walks of nsteps steps from random cells, looking up the state of the 4 neighbors at each step
+double Walk(const TRaster& r, int nwalkers, int nsteps, long& sum)
+{
+ int dx[4] = {-1, 0, 1, 0};
+ int dy[4] = {0, -1, 0, 1};
+ clock_t t = clock();
+ for (int w=0; w<nwalkers; w++)
+   {
+   int x = Rnd() % r.nrows();
+   int y = Rnd() % r.ncols();
+   for (int s=0; s<nsteps; s++)
+     {
+     int n = 0;
+     for (int k=0; k<4; k++)
+       {
+       int nx = x + dx[k];
+       int ny = y + dy[k];
+       if (nx>=0 && nx<r.nrows() && ny>=0 && ny<r.ncols())
+         n += r.IsSink(nx,ny) + 2*r.IsFree(nx,ny);
+       }
+     sum += n;
+     int k = Rnd() % 4;
+     x = MIN(MAX(x+dx[k],0), r.nrows()-1);
+     y = MIN(MAX(y+dy[k],0), r.ncols()-1);
+     }
+   }
+ return double(clock()-t) / CLOCKS_PER_SEC * 1e9 / (double(nwalkers)*nsteps);
+}
+
+// WalkInterleaved: as Walk, but nwalkers walkers advance one step each in turn, so that consecutive lookups are far apart
+double WalkInterleaved(const TRaster& r, int nwalkers, int nsteps, long& sum)
+{
+ int dx[4] = {-1, 0, 1, 0};
+ int dy[4] = {0, -1, 0, 1};
+ vector<int> x(nwalkers), y(nwalkers);
+ for (int w=0; w<nwalkers; w++)
+   {
+   x[w] = Rnd() % r.nrows();
+   y[w] = Rnd() % r.ncols();
+   }
+ clock_t t = clock();
+ for (int s=0; s<nsteps; s++)
+   for (int w=0; w<nwalkers; w++)
+     {
+     int n = 0;
+     for (int k=0; k<4; k++)
+       {
+       int nx = x[w] + dx[k];
+       int ny = y[w] + dy[k];
+       if (nx>=0 && nx<r.nrows() && ny>=0 && ny<r.ncols())
+         n += r.IsSink(nx,ny) + 2*r.IsFree(nx,ny);
+       }
+     sum += n;
+     int k = Rnd() % 4;
+     x[w] = MIN(MAX(x[w]+dx[k],0), r.nrows()-1);
+     y[w] = MIN(MAX(y[w]+dy[k],0), r.ncols()-1);
+     }
+ return double(clock()-t) / CLOCKS_PER_SEC * 1e9 / (double(nwalkers)*nsteps);
+}
+
+// Neighbors: looks up the 8 neighbors of a sequence of adjacent cells, as when a home range grows
+double Neighbors(const TRaster& r, int nranges, int ncells, long& sum)
+{
+ clock_t t = clock();
+ for (int h=0; h<nranges; h++)
+   {
+   int x = 1 + Rnd() % (r.nrows()-2);
+   int y = 1 + Rnd() % (r.ncols()-2);
+   for (int c=0; c<ncells; c++)
+     {
+     for (int i=-1; i<=1; i++)
+       for (int j=-1; j<=1; j++)
+         if (i!=0 || j!=0)
+           sum += (r.FreeAffinity(x+i,y+j) >= 0);
+     x = MIN(MAX(x + int(Rnd()%3) - 1, 1), r.nrows()-2);
+     y = MIN(MAX(y + int(Rnd()%3) - 1, 1), r.ncols()-2);
+     }
+   }
+ return double(clock()-t) / CLOCKS_PER_SEC * 1e9 / (double(nranges)*ncells);
+}
+
+int main(int argc, char* argv[])
+{
+ int nrows = (argc > 1) ? atoi(argv[1]) : 6000;
+ int ncols = (argc > 2) ? atoi(argv[2]) : 6000;
+ int storage = (argc > 3) ? atoi(argv[3]) : DenseStorage;
+ const char* names[2] = {"row major", "tiled 8x8"};
+
+ cout << nrows << " x " << ncols << " landscape, " << (storage==CompactStorage ? "compact" : "dense") << " storage\n";
+ long sum = 0;
+ for (int layout=RowMajorLayout; layout<=((storage==DenseStorage) ? RowMajorLayout : TiledLayout); layout++)
+   {
+   TRaster r;
+     {
+     Mat_DP land(nrows, ncols);
+     double classes[4] = {0, 0.25, 0.5, 1};
+     for (int i=0; i<nrows; i++)
+       for (int j=0; j<ncols; j++)
+         land[i][j] = (i%100==0 || j%150==0) ? 0 : classes[Rnd()%4];   // roads every 100 rows and 150 columns
+     r.Build(land, storage, layout);
+     }
+   for (long k=0; k<long(nrows)*ncols/50; k++)   // occupies 2% of the cells
+     r.Occupy(Rnd()%nrows, Rnd()%ncols);
+
+   rndstate = 2463534242u;
+   double walk = Walk(r, 200000, 200, sum);
+   double walks = WalkInterleaved(r, 200000, 200, sum);
+   double neigh = Neighbors(r, 200000, 200, sum);
+   cout << names[layout] << ":\t" << walk << " ns per walk step (one walker at a time),\t"
+        << walks << " ns per walk step (interleaved walkers),\t" << neigh << " ns per 8-neighborhood\n";
+   }
+ cout << "(checksum " << sum << ")\n";
+ return 0;
+}
@@ -11,6 +11,43 @@
 #include <sys/time.h>
 
 
+// Allocation count: compiled with ALLOCSTATS defined, the calls to operator new are counted and
+// Step writes to cerr the number of allocations of each step (without the output of the generation)
+// The containers used in a step keep their memory between steps, so after the first steps only
+// the growth of the population and of the indexes of free cells should allocate
+
+#ifdef ALLOCSTATS
+static long nallocations = 0;
+
+void* operator new(size_t n)
+{
+ nallocations++;
+ void* p = malloc(n);
+ if (!p)
+   throw bad_alloc();
+ return p;
+}
+
+void operator delete(void* p) throw()
+{
+ free(p);
+}
+#endif
+
+
+// Constructor of TSimParam: default values of the parameters that are optional
+
+TSimParam::TSimParam()
+{
+ land = 0;
+ landstorage = DenseStorage;
+ landlayout = RowMajorLayout;
+ aggregate = 0;
+ walkers = 1;
+ threads = 0;
+}
+
+
 // Constructor of TSimulator (it is run when the object is first created): initializes and starts the simulation
 
 TSimulator::TSimulator(const TSimParam& param)
@@ -37,7 +74,7 @@ TSimulator::TSimulator(const TSimParam& param)
  //stores the parameter values of the simulation in local variables to the object
  nsteps=param.nsteps;
  initpopulation=param.initpopulation;
- hrsize=param.hrsize;
+ hrsize=MAX(1,param.hrsize);   // a home range of 0 cells has the cell where it started, as one of 1 cell
  birthrate=param.birthrate;
  breedingage=param.breedingage;
  survival=param.survival;
@@ -47,40 +84,47 @@ TSimulator::TSimulator(const TSimParam& param)
  neighavoidance=param.neighavoidance;
  sinkavoidance=param.sinkavoidance;
  sinkmortality=param.sinkmortality;
+ landstorage=param.landstorage;
+ landlayout=param.landlayout;
+ walkers=param.walkers;
+ threads=param.threads;
     
  filename=param.filename;
 
  // the first step of the simulation is run here so the step counter is set to 1
  step=1;
     
- // creates a landscape object based on the input landscape in param.land
- landscape = new TLandscape(this,param.land);
+ // creates a landscape object based on the input landscape in param.land, or mapped from param.landfile
+ if (param.landfile.empty())
+   landscape = new TLandscape(this,param.land);
+ else landscape = new TLandscape(this,param.landfile);
+ int nrows = landscape->GetRaster().nrows();
+ int ncols = landscape->GetRaster().ncols();
 
  // writes in the output file (with name filename) the value of the parameters
  OutputParameters();
 
- // creates an optimal landscape with the same size of the landscape of the simulation
- // in the optimal landscpae all cells have habitat affinity 1
- TLandscape landscapeopt(this,1,param.land->nrows(),param.land->ncols());
- optimalfitness = landscapeopt.CalculateOptimalFitness();
  // optimalfitness is the fitness of an individual with the best possible home range in an empty and uniform landscape
- // it corresponds to the normalizing value Phi
+ // of the size of the landscape of the simulation, it corresponds to the normalizing value Phi
+ optimalfitness = TLandscape::OptimalFitness(this,nrows,ncols);
 
  // starts at the center
- TCell mothercell(param.land->nrows()/2,param.land->ncols()/2);
- 
- // creates the initial population of individuals (ninitpopulation objects of the class TIndividual) and stores them in the population list of individuals
- for (int n=0; n<initpopulation; n++)
-   population.push_back(TIndividual(this,mothercell));
+ TCell mothercell(nrows/2,ncols/2);
  
+ // creates the initial population of individuals (ninitpopulation juveniles born in mothercell)
+ population = new TPopulation(this);
+ TJuveniles founders(1, TBrood(mothercell,initpopulation));
+
+ // with global dispersal and single cell home ranges the population can be kept as numbers of individuals
+ aggregate = NULL;
+ if (param.aggregate!=0 && dispersalmode==0 && hrsize==1)
+   aggregate = new TAggregate(this, param.aggregate==1);
+
  // setlles the home range of each individual in the initial population
- for_each(population.begin(),population.end(),
-          mem_fun_ref(&TIndividual::SettleHomeRange));
- 
-// kill floaters (individuals with empty home ranges)
- population.erase(remove_if(population.begin(),population.end(),
-                            mem_fun_ref(&TIndividual::HasEmptyHomeRange)),
-                  population.end());
+ // and keeps those that settled (floaters, individuals without home range, die)
+ if (aggregate)
+   aggregate->Settle(initpopulation);
+ else population->Settle(founders);
  
  // writes in the output file the list of the cells of each individual and the ages of each individual
  OutputGeneration();
@@ -91,38 +135,37 @@ TSimulator::TSimulator(const TSimParam& param)
 
 void TSimulator::Step()
 {
- TPopulation popjuv;      // list of juveniles
+#ifdef ALLOCSTATS
+ long nalloc = nallocations;
+#endif
+ popjuv.clear();          // list of juveniles
 
  step++;                  // increases step counter
+
+ if (aggregate)           // the same step with the numbers of individuals
+   {
+   aggregate->Step();
+   OutputGeneration();
+   return;
+   }
     
- // increases ages for each individual and produces juveniles (stores in popjuv)
- for (TPopulation::iterator i = population.begin(); i!=population.end(); i++)
-      i->ApplyBreeding(popjuv);
-
- // kill adults randomly and remove them from the population (adult mortality)
- population.erase(remove_if(population.begin(),population.end(),
-                            mem_fun_ref(&TIndividual::ApplyMortality)),
-                  population.end());
+ // increases ages for each individual and produces juveniles (stores in popjuv),
+ // kill adults randomly, release their cells and remove them from the population (adult mortality)
+ population->ApplyBreedingAndMortality(popjuv);
     
- landscape->Update(population);  // actualize matrix of free cells opened by adult mortality
+ landscape->Update();  // releases the cells of home ranges that failed to settle in the previous step
     
     
  // kill juveniles randomly and remove them from the population (first stage of juvenile mortality)
- popjuv.erase(remove_if(popjuv.begin(),popjuv.end(),
-                            mem_fun_ref(&TIndividual::ApplyMortality)),
-                  popjuv.end());
- 
- // settle the home-range of each juvenile
- for_each(popjuv.begin(),popjuv.end(),
-          mem_fun_ref(&TIndividual::SettleHomeRange));
+ population->ApplyJuvenileMortality(popjuv);
  
- // kill juveniles without home-range (floaters)
- popjuv.erase(remove_if(popjuv.begin(),popjuv.end(),
-                            mem_fun_ref(&TIndividual::HasEmptyHomeRange)),
-                  popjuv.end());
- 
- // insert juveniles into the adult population
- population.insert(population.end(), popjuv.begin(), popjuv.end());
+ // settle the home-range of each juvenile and insert those that settled into the adult population
+ // (juveniles without home-range, floaters, die)
+ population->Settle(popjuv);
+
+#ifdef ALLOCSTATS
+ cerr << "step " << step << ": " << nallocations-nalloc << " allocations\n";
+#endif
   
  // writes in the output file the list of the cells of each individual and the ages of each individual
  OutputGeneration();
@@ -162,32 +205,37 @@ void TSimulator::OutputGeneration()
  // opens a file with name filename for writing
  ofstream os(filename.c_str(),ios_base::app);
     
+ if (aggregate)
+   {
+   // the home ranges are only written when they are drawn (see TAggregate)
+   if (aggregate->Positions())
+     {
+     os << "hrmaphist[[" << step << "]]=\n{";
+     aggregate->OutputHomeRanges(os);
+     os << "};\n";
+     }
+   os << "ageshist[[" << step << "]]=\n{";
+   aggregate->OutputAges(os);
+   os << "};\n";
+   os << "popsize[[" << step << "]]=\n";
+   os << aggregate->Size() << ";\n";
+   return;
+   }
+
  // writes a list of the list of home range cells of each individual in a Mathematica format
  os << "hrmaphist[[" << step << "]]=\n{";
 
- for (TPopulation::iterator i=population.begin();
-      i!=population.end(); i++)
-    {
-    i->OutputHomeRange(os);
-    if (i != --population.end())
-      os << ",\n";
-    }
+ population->OutputHomeRanges(os);
  os << "};\n";
 
     
  // writes a list of the individual ages in a Mathematica format   
  os << "ageshist[[" << step << "]]=\n{";
- for (TPopulation::iterator i=population.begin();
-      i!=population.end(); i++)
-   {
-   os << i->GetAge();
-   if (i != --population.end())
-     os << ", ";
-   }
+ population->OutputAges(os);
  os << "};\n";
     
  os << "popsize[[" << step << "]]=\n";
- os << population.size() << ";\n";
+ os << population->Size() << ";\n";
 }
 
 
@@ -195,5 +243,8 @@ void TSimulator::OutputGeneration()
 
 TSimulator::~TSimulator()
 {
+ delete population;
+ delete aggregate;
  delete landscape;
+ delete sto;
 }
@@ -3,7 +3,8 @@
 
 #include <list>
 #include "landscape.h"
-#include "individual.h"
+#include "population.h"
+#include "aggregate.h"
 
 using namespace std;
 
@@ -24,9 +25,12 @@ using namespace std;
 struct TSimParam
 {
  Mat_DP* land;           // matrix with landscape, each cell having a habitat quality between 0 and 1
+ string landfile;
+    // Raster file with the landscape (see TRasterHeader in raster.h), not passed from Mathematica
+    // When given, the file is mapped in memory and read in place, and land is not used
  int initpopulation;     // initial population size
  int nsteps;             // number of steps in simulation
- int hrsize;             // home range size
+ int hrsize;             // home range size, 0 is the same as 1
  double birthrate;       // fecundity per individual (see CalculateOffspring for stochastic/determinitisc options)
  int breedingage;        // age of first breeding
  double survival;
@@ -52,6 +56,39 @@ struct TSimParam
  double sinkmortality;
     // Probability (per dispersal step) of dying in a sink habitat (habitat quality 0, e.g. roads)
  string filename;
+ int landstorage;
+    // Storage of the landscape in memory (see TLandStorage in raster.h), not passed from Mathematica
+        // 0: dense, habitat affinity and free cells as matrices of doubles
+        // 1: compact, habitat affinity quantized in 8 or 16 bit classes and free cells as a bitset
+        // 3: sparse, as compact but only for the tiles of 8x8 cells with habitat, for landscapes that are mostly sink or nodata
+        // Ignored for a landfile, which is read in place
+        // With the index of the free cells (8 bytes per cell), dense storage takes about 24 bytes per cell and compact about 9 to 10
+ int landlayout;
+    // Layout of the cells of the landscape in memory (see TLandLayout in raster.h), not passed from Mathematica
+        // 0: row by row
+        // 1: tiles of 8x8 cells, for compact storage of landscapes much larger than the cache
+        // Ignored for dense storage and for a landfile, which are always row by row, and for sparse storage, which is always tiled
+ int aggregate;
+    // Population kept as numbers of individuals (see TAggregate in aggregate.h), not passed from Mathematica
+        // 0: individuals
+        // 1: numbers of individuals with global dispersal (mode 0) and home ranges of one cell, the home ranges of the output are drawn
+        //    again at each step, so an individual that survives is not in the same cell in the successive home ranges of hrmaphist
+        // 2: as 1, without the home ranges of the output (hrmaphist is not written)
+        // Ignored for other dispersal modes and home range sizes, which always keep the individuals
+ int walkers;
+    // Number of random walks of dispersal mode 2 that run in lockstep (see TLandscape::Walk), not passed from Mathematica
+        // 0 or 1 (default): one walk at a time
+        // 2 or more: walks of that many juveniles at a time. The walks draw other random numbers than one at a time, so the
+        // results for a seed are not those of 1. Only used without neighbor avoidance, when the walks of the juveniles of a
+        // step do not depend on each other
+ int threads;
+    // Number of threads of the settlement of dispersal modes 1 and 2 in two phases (see TPopulation::SettleSpeculative), not passed from Mathematica
+        // but given as the second argument of the command line in main.cpp, after the raster file
+        // 0: the juveniles search one at a time
+        // 1 or more: the juveniles search and their home ranges grow at the same time in that many threads, and then settle in order. The results are the
+        // same for any number of threads, but not those of 0 (the juveniles draw other random numbers). The threads are started in the first batch and
+        // wait for the next batches until the end of the simulation (see TWorkerPool)
+ TSimParam();
 };
 
 class TSimulator
@@ -61,7 +98,9 @@ class TSimulator
         void OutputGeneration();
         void OutputParameters();
         // data members
-        TPopulation population;  //population of settlers
+        TPopulation* population;  //population of settlers
+        TAggregate* aggregate;    // population as numbers of individuals, NULL when the individuals are kept
+        TJuveniles popjuv;        // juveniles of the current step, kept between steps so that its memory is reused
         TLandscape* landscape;
         int nsteps;
         unsigned int hrsize;
@@ -77,6 +116,10 @@ class TSimulator
         double neighavoidance;
         double sinkmortality;
         string filename;
+        int landstorage;
+        int landlayout;
+        int walkers;
+        int threads;
         double optimalfitness;
  public:
         TSimulator(const TSimParam&);
@@ -90,12 +133,16 @@ class TSimulator
         TLandscape* GetLandscape() {return landscape;}
         double GetOptimalFitness() {return optimalfitness;}
         const char* GetFileName() {return filename.c_str();}
-        long GetPopulationSize() {return population.size();}
+        long GetPopulationSize() {return aggregate ? aggregate->Size() : population->Size();}
         int GetDispersalMode() {return dispersalmode;}
         double GetDispersalDistance() {return dispersaldistance;}
         double GetSinkAvoidance() {return sinkavoidance;}
         double GetNeighAvoidance() {return neighavoidance;}
         double GetSinkMortality() {return sinkmortality;}
+        int GetLandStorage() {return landstorage;}
+        int GetLandLayout() {return landlayout;}
+        int GetWalkers() {return walkers;}
+        int GetThreads() {return threads;}
     
         int GetStep() {return step;}
 		int GetNSteps() {return nsteps;}
@@ -64,6 +64,10 @@
 * uint32_t BRandom();
 * Gives 32 random bits. 
 *
+* void BRandom(uint32_t * destination, int n);
+* Gives n times 32 random bits, the same as n calls to BRandom().
+* In CRandomMersenne only.
+*
 *
 * Example:
 * ========
@@ -173,8 +177,10 @@ public:
    int IRandomX(int min, int max);     // Output random integer, exact
    double Random();                    // Output random float
    uint32_t BRandom();                 // Output random bits
+   void BRandom(uint32_t * destination, int n); // Output n times random bits
 private:
    void Init0(int seed);               // Basic initialization procedure
+   void Generate();                    // Generate MERS_N words of the state
    uint32_t mt[MERS_N];                // State vector
    int mti;                            // Index into mt
    uint32_t LastInterval;              // Last interval length for IRandomX
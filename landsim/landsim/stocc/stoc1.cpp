@@ -23,6 +23,7 @@
 * GNU General Public License http://www.gnu.org/licenses/gpl.html
 *****************************************************************************/
 
+#include <string.h>
 #include "stocc.h"     // class definition
 
 
@@ -82,6 +83,9 @@ StochasticLib1::StochasticLib1 (int seed)
    normal_x2_valid = 0;
    hyp_n_last = hyp_m_last = hyp_N_last = -1; // Last values of hypergeometric parameters
    pois_L_last = -1.;                         // Last values of Poisson parameters
+   for (int i = 0; i < (1 << POIS_TABLE_BITS); i++) {  // Poisson tables
+      pois_tables[i].L = -1.;  pois_tables[i].built = 0;  pois_tables[i].misses = 0;
+   }
    bino_n_last = -1;  bino_p_last = -1.;      // Last values of binomial parameters
 }
 
@@ -405,6 +409,22 @@ int32_t StochasticLib1::Poisson (double L) {
 }
 
 
+void StochasticLib1::Poisson (int32_t * destination, const double * L, int32_t n) {
+   // n variates of the Poisson distribution with means L[0..n-1], in
+   // the same order as n calls to Poisson(L[i]). Means equal to 0 give 0
+   // without using random numbers, as in Poisson. Means for which Poisson
+   // uses inversion are sampled with PoissonTable, which gives the same
+   // values. The random bits are not generated in blocks as in Bernoulli:
+   // a variate takes one or more random numbers depending on its method
+   // and on the numbers it draws, so bits generated ahead would change the
+   // numbers of the calls that follow.
+   for (int32_t i = 0; i < n; i++) {
+      if (L[i] >= 1.E-6 && L[i] < 17) destination[i] = PoissonTable(L[i]);
+      else destination[i] = Poisson(L[i]);
+   }
+}
+
+
 /***********************************************************************
 Subfunctions used by poisson
 ***********************************************************************/
@@ -436,11 +456,9 @@ int32_t StochasticLib1::PoissonInver(double L) {
 
    Execution time grows with L. Gives overflow for L > 80.
 
-   The value of bound must be adjusted to the maximal value of L.
+   The value of bound in PoissonChopDown must be adjusted to the maximal
+   value of L.
    */   
-   const int bound = 130;              // safety bound. Must be > L + 8*sqrt(L).
-   double r;                           // uniform random number
-   double f;                           // function value
    int32_t x;                          // return value
 
    if (L != pois_L_last) {             // set up
@@ -448,19 +466,95 @@ int32_t StochasticLib1::PoissonInver(double L) {
       pois_f0 = exp(-L);               // f(0) = probability of x=0
    }
    while (1) {  
-      r = Random();  x = 0;  f = pois_f0;
-      do {                             // recursive calculation: f(x) = f(x-1) * L / x
-         r -= f;
-         if (r <= 0) return x;
-         x++;
-         f *= L;
-         r *= x;                       // instead of f /= x
-      }
-      while (x <= bound);
+      x = PoissonChopDown(L, pois_f0, Random());
+      if (x >= 0) return x;
    }
 }  
 
 
+int32_t StochasticLib1::PoissonChopDown(double L, double f0, double r) {
+   /*
+   This subfunction makes the inversion by the chop down method of the
+   uniform random number r for PoissonInver, with f0 = exp(-L).
+   Returns -1 if r is not inverted within the safety bound.
+   */   
+   const int bound = 130;              // safety bound. Must be > L + 8*sqrt(L).
+   double f = f0;                      // function value
+   int32_t x = 0;                      // return value
+
+   do {                                // recursive calculation: f(x) = f(x-1) * L / x
+      r -= f;
+      if (r <= 0) return x;
+      x++;
+      f *= L;
+      r *= x;                          // instead of f /= x
+   }
+   while (x <= bound);
+   return -1;
+}
+
+
+int32_t StochasticLib1::PoissonTable(double L) {
+   /*
+   This subfunction generates a random variate with the poisson 
+   distribution with the same values as PoissonInver, for values of L
+   that are used many times.
+
+   Each step of the chop down method only subtracts from r and multiplies
+   it by positive numbers, so the variate never decreases when r increases.
+   It is then given by the thresholds of the random bits, BRandom(), at
+   which it increases. These thresholds are found by bisection the second
+   time L is used, and kept in a table, so that a variate only takes
+   comparisons of integers. This requires Random() = BRandom() * 2^(-32),
+   as in CRandomMersenne. A table in use is only replaced by another value
+   of L that goes to the same table after many uses of other values.
+   */   
+   uint64_t bits;
+   memcpy(&bits, &L, sizeof(bits));
+   PoisTable & table = pois_tables[(bits * 0x9E3779B97F4A7C15ULL) >> (64 - POIS_TABLE_BITS)];
+
+   if (table.L != L) {                 // first use of L: no table yet
+      if (table.built && ++table.misses < 64) return PoissonInver(L);
+      table.L = L;  table.built = 0;  table.misses = 0;
+      return PoissonInver(L);
+   }
+   table.misses = 0;
+   if (!table.built) {                 // second use of L: calculate the table
+      const double scale = 1./(65536.*65536.);
+      double f0 = exp(-L);
+      uint64_t lo, hi, mid;
+      // random bits from which the inversion fails (the largest r)
+      lo = 0;  hi = (uint64_t)1 << 32;
+      while (lo < hi) {
+         mid = (lo + hi) / 2;
+         if (PoissonChopDown(L, f0, mid * scale) < 0) hi = mid;  else lo = mid + 1;
+      }
+      table.fail = lo;
+      // t[x]: least random bits that give more than x, or fail
+      table.n = 0;  lo = 0;
+      while (table.n < POIS_TABLE_N) {
+         hi = table.fail;
+         while (lo < hi) {
+            mid = (lo + hi) / 2;
+            int32_t x = PoissonChopDown(L, f0, mid * scale);
+            if (x < 0 || x > table.n) hi = mid;  else lo = mid + 1;
+         }
+         if (lo >= table.fail) break;
+         table.t[table.n++] = (uint32_t)lo;
+      }
+      table.built = 1;
+   }
+   uint32_t b;
+   do {
+      b = BRandom();
+   }
+   while (b >= table.fail);            // inversion fails: new random number, as in PoissonInver
+   int32_t x = 0;
+   while (x < table.n && b >= table.t[x]) x++;
+   return x;
+}
+
+
 int32_t StochasticLib1::PoissonRatioUniforms(double L) {
    /*
    This subfunction generates a random variate with the poisson 
@@ -788,6 +882,30 @@ int StochasticLib1::Bernoulli(double p) {
 }
 
 
+void StochasticLib1::Bernoulli(int8_t * destination, double p, int32_t n) {
+   // n variates of the Bernoulli distribution with parameter p, the same
+   // as n calls to Bernoulli(p). With Random() = BRandom() * 2^(-32),
+   // as in CRandomMersenne, Random() < p is the same as BRandom() < p * 2^32,
+   // so the random bits are compared with an integer threshold instead of
+   // being converted to floating point. The bits are generated in blocks
+   // and compared in a loop that the compiler can vectorize.
+   if (p < 0 || p > 1) FatalError("Parameter out of range in Bernoulli function");
+   uint64_t threshold = (uint64_t)ceil(p * (65536.*65536.));
+   uint32_t last = (uint32_t)(threshold - 1);  // largest bits that give 1
+   uint32_t bits[256];
+   for (int32_t i = 0; i < n; i += 256) {
+      int m = n - i < 256 ? int(n - i) : 256;
+      BRandom(bits, m);
+      if (threshold == 0) {            // p == 0: the bits are still drawn
+         for (int k = 0; k < m; k++) destination[i+k] = 0;
+      }
+      else {
+         for (int k = 0; k < m; k++) destination[i+k] = bits[k] <= last;
+      }
+   }
+}
+
+
 /***********************************************************************
 Shuffle function
 ***********************************************************************/
@@ -38,6 +38,10 @@
 * int Bernoulli(double p);
 * Bernoulli distribution. Gives 0 or 1 with probability 1-p and p.
 *
+* void Bernoulli(int8_t * destination, double p, int32_t n);
+* n variates of the Bernoulli distribution with the same p. Gives the same
+* values as n calls to Bernoulli(p).
+*
 * double Normal(double m, double s);
 * Normal distribution with mean m and standard deviation s.
 *
@@ -47,6 +51,11 @@
 * int32_t Poisson (double L);
 * Poisson distribution with mean L.
 *
+* void Poisson (int32_t * destination, const double * L, int32_t n);
+* n variates of the Poisson distribution with means L[0..n-1]. Gives the same
+* values as n calls to Poisson(L[i]). Means below 17 that come back often
+* are sampled from tables of the inversion method (see PoissonTable).
+*
 * int32_t Binomial (int32_t n, double p);
 * Binomial distribution. n trials with probability p.
 *
@@ -282,9 +291,11 @@ class StochasticLib1 : public STOC_BASE {
 public:
    StochasticLib1 (int seed);          // Constructor
    int Bernoulli(double p);            // Bernoulli distribution
+   void Bernoulli(int8_t * destination, double p, int32_t n); // n Bernoulli variates
    double Normal(double m, double s);  // Normal distribution
    double NormalTrunc(double m, double s, double limit); // Truncated normal distribution
    int32_t Poisson (double L);         // Poisson distribution
+   void Poisson (int32_t * destination, const double * L, int32_t n); // n Poisson variates
    int32_t Binomial (int32_t n, double p); // Binomial distribution
    int32_t Hypergeometric (int32_t n, int32_t m, int32_t N); // Hypergeometric distribution
    void Multinomial (int32_t * destination, double * source, int32_t n, int colors); // Multinomial distribution
@@ -298,6 +309,8 @@ protected:
 
    // subfunctions for each approximation method
    int32_t PoissonInver(double L);                         // poisson by inversion
+   int32_t PoissonChopDown(double L, double f0, double r); // inversion of one random number
+   int32_t PoissonTable(double L);                         // poisson by inversion with a table
    int32_t PoissonRatioUniforms(double L);                 // poisson by ratio of uniforms
    int32_t PoissonLow(double L);                           // poisson for extremely low L
    int32_t BinomialInver (int32_t n, double p);            // binomial by inversion
@@ -325,6 +338,19 @@ protected:
    double pois_g;                                          // ln(L)
    int32_t  pois_bound;                                    // upper bound
 
+   // Variables used by Poisson with tables (PoissonTable), for the last values of L
+   // Each L goes to one of the tables, and its table is calculated when L comes back
+   enum {POIS_TABLE_BITS = 6,                              // number of tables = 2^POIS_TABLE_BITS
+         POIS_TABLE_N = 132};                              // maximal length of a table, > bound of PoissonInver
+   struct PoisTable {
+      double L;                                            // value of L, -1 if none
+      int built;                                           // table calculated
+      int misses;                                          // uses by other values of L since L was used
+      int32_t n;                                           // number of thresholds
+      uint64_t fail;                                       // least random bits for which inversion fails
+      uint32_t t[POIS_TABLE_N];                            // t[x]: least random bits that give more than x
+   } pois_tables[1 << POIS_TABLE_BITS];
+
    // Variables used by Binomial distribution
    int32_t bino_n_last;                                    // last n
    double bino_p_last;                                     // last p
@@ -0,0 +1,54 @@
+#include "tilehash.h"
+
+
+// Constructor of TTileHash: creates an empty hash
+
+TTileHash::TTileHash()
+{
+ Clear();
+}
+
+
+// Clear: removes all the keys, leaving a hash of 16 entries
+
+void TTileHash::Clear()
+{
+ keys.assign(16, -1);
+ slots.assign(16, -1);
+ shift = 60;
+ n = 0;
+}
+
+
+// Insert: adds a key that is not in the hash with its slot
+// When the hash would be more than half full it is doubled and all the keys are added again
+
+void TTileHash::Insert(long key, int slot)
+{
+ n++;
+ if (2*size_t(n) > keys.size())
+   {
+   vector<long> oldkeys(keys.size()*2, -1);
+   vector<int> oldslots(slots.size()*2, -1);
+   oldkeys.swap(keys);
+   oldslots.swap(slots);
+   shift--;
+   for (size_t h=0; h<oldkeys.size(); h++)
+     if (oldkeys[h] >= 0)
+       Put(oldkeys[h], oldslots[h]);
+   }
+ Put(key, slot);
+}
+
+
+// Put: stores a key in the first empty entry from its hash
+
+void TTileHash::Put(long key, int slot)
+{
+ size_t mask = keys.size() - 1;
+ size_t h = size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> shift);
+ while (keys[h] >= 0)
+   h = (h + 1) & mask;
+ keys[h] = key;
+ slots[h] = slot;
+}
@@ -0,0 +1,44 @@
+#ifndef _TILEHASH_H_
+#define _TILEHASH_H_
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// TTileHash: open addressing hash of the numbers of tiles or blocks (non negative) to their slots in an array
+// Sparse storage finds its stored tiles through it (see TRaster) and the block index its stored blocks (see
+// TBlockIndex). The hash is kept at most half full, so a lookup takes few probes, and keys are never removed.
+
+class TTileHash
+{
+ public:
+   TTileHash();
+   void Clear();
+   inline int Find(long key) const;     // slot of a key, -1 if it is not in the hash
+   void Insert(long key, int slot);
+   int Size() const {return n;}
+ private:
+   void Put(long key, int slot);
+
+   vector<long> keys;                   // -1 in empty entries
+   vector<int> slots;
+   int shift;                           // 64 minus the bits of the number of entries
+   int n;                               // number of keys
+};
+
+
+inline int TTileHash::Find(long key) const
+{
+ size_t mask = keys.size() - 1;
+ size_t h = size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> shift);
+ while (keys[h] != key)
+   {
+   if (keys[h] < 0)
+     return -1;
+   h = (h + 1) & mask;
+   }
+ return slots[h];
+}
+
+#endif
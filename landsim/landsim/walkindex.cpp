@@ -0,0 +1,145 @@
+#include "walkindex.h"
+
+
+// Directions of the neighbors of a cell, in the order in which ChooseStartingPointMode2 lists them
+
+static const int walkdx[4] = {-1, 0, 1, 0};
+static const int walkdy[4] = {0, -1, 0, 1};
+static const int walkpow[4] = {2, 10, 50, 250};   // weight of each neighbor in the code
+
+
+// Constructor of TWalkIndex: creates an empty index
+
+TWalkIndex::TWalkIndex() : xmax(0), ymax(0), tracking(false)
+{
+}
+
+
+// Build: calculates the transitions of each code and the code of each cell of the raster
+// The state of a neighbor is 0 if it is outside the landscape, and otherwise 1, plus 1 if it is sink, plus 2 if it is
+// occupied. The cumulative probabilities are calculated as in the walk, so the steps are the same.
+
+void TWalkIndex::Build(const TRaster* land, double sinkavoidance, double neighavoidance)
+{
+ xmax = land->nrows();
+ ymax = land->ncols();
+
+ steps.resize(1250);
+ for (int c=0; c<1250; c++)
+   {
+   TWalkStep& s = steps[c];
+   double neighprob[4];
+   double cumprob=0;
+   s.n = 0;
+   s.insink = c & 1;
+   for (int k=0; k<4; k++)   // missing neighbors, with no step
+     {
+     s.dx[k] = s.dy[k] = 0;
+     s.sink[k] = false;
+     }
+   for (int d=0, states=c/2; d<4; d++, states/=5)
+     {
+     int state = states%5;
+     if (state==0)
+       continue;
+     bool sink = (state==2 || state==4);
+     bool occupied = (state>=3);
+     double prob=1.0;   // default probability of dispersing to a neighbor
+     if (sink&&occupied)
+       prob=1-MAX(sinkavoidance,neighavoidance);
+     else if (sink)
+       prob=1-sinkavoidance;
+     else if (occupied)
+       prob=1-neighavoidance;
+     cumprob+=prob;
+     neighprob[s.n]=cumprob;
+     s.dx[s.n] = walkdx[d];
+     s.dy[s.n] = walkdy[d];
+     s.sink[s.n] = sink;
+     s.n++;
+     }
+   if (cumprob==0)   // if all probabilities are zero the walk cannot move, and chooses a missing neighbor
+     {
+     s.n = 0;
+     s.dx[0] = s.dy[0] = 0;
+     s.sink[0] = false;
+     }
+   for (int k=0; k<4; k++)
+     s.cumprob[k] = (k<s.n) ? neighprob[k]/cumprob : 2;
+   }
+
+ code.assign(long(xmax)*ymax, 0);
+ for (int x=0; x<xmax; x++)
+   for (int y=0; y<ymax; y++)
+     {
+     int c = land->IsSink(x,y) ? 1 : 0;
+     for (int d=0; d<4; d++)
+       {
+       int i = x + walkdx[d];
+       int j = y + walkdy[d];
+       if (i>=0 && i<xmax && j>=0 && j<ymax)
+         c += walkpow[d] * (1 + (land->IsSink(i,j) ? 1 : 0) + (land->IsFree(i,j) ? 0 : 2));
+       }
+     code[long(x)*ymax + y] = uint16_t(c);
+     }
+}
+
+
+// Occupy: updates the codes of the neighbors of a cell that was occupied
+
+void TWalkIndex::Occupy(int x, int y)
+{
+ Change(x, y, 2);
+}
+
+
+// Free: updates the codes of the neighbors of a cell that was freed
+
+void TWalkIndex::Free(int x, int y)
+{
+ Change(x, y, -2);
+}
+
+
+// Change: adds delta to the state of the cell (x,y) in the codes of its neighbors, where it is in the opposite direction
+
+void TWalkIndex::Change(int x, int y, int delta)
+{
+ if (code.empty())   // the index was not built
+   return;
+ for (int d=0; d<4; d++)
+   {
+   int i = x - walkdx[d];
+   int j = y - walkdy[d];
+   if (i>=0 && i<xmax && j>=0 && j<ymax)
+     {
+     long c = long(i)*ymax + j;
+     code[c] += delta * walkpow[d];
+     if (tracking && !changed[c])
+       {
+       changed[c] = 1;
+       marked.push_back(c);
+       }
+     }
+   }
+}
+
+
+// Track: starts marking the cells whose code changes
+
+void TWalkIndex::Track()
+{
+ changed.resize(code.size(), 0);
+ tracking = true;
+}
+
+
+// Untrack: stops marking the cells whose code changes, and clears the marks
+
+void TWalkIndex::Untrack()
+{
+ for (vector<long>::const_iterator i=marked.begin(); i!=marked.end(); ++i)
+   changed[*i] = 0;
+ marked.clear();
+ tracking = false;
+}
@@ -0,0 +1,65 @@
+#ifndef _WALKINDEX_H_
+#define _WALKINDEX_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "raster.h"
+
+using namespace std;
+
+// TWalkIndex: transition tables of the random walk of dispersal mode 2 (see ChooseStartingPointMode2)
+// The probability of stepping to a neighbor only depends on whether it is in the landscape, is sink and is occupied,
+// so the neighborhood of a cell is one of 5^4 states (the state of each of its 4 neighbors) and the cumulative
+// probabilities of the steps are calculated once for each. Each cell keeps a code with the state of its neighborhood
+// and whether the cell itself is sink, so that a step of the walk reads a single code. The code of a cell only changes
+// when one of its neighbors is occupied or freed. While tracking, the cells whose code changed are marked, so that
+// a walk computed before can be checked step by step (see TLandscape::Confirm).
+
+struct TWalkStep
+{
+   int n;              // number of neighbors, 0 if the walk cannot move (all the probabilities are zero)
+   bool insink;        // whether the cell is sink
+   int dx[4];          // displacement to each neighbor, 0 for the missing ones
+   int dy[4];
+   bool sink[4];       // whether each neighbor is sink, false for the missing ones
+   double cumprob[4];  // cumulative probability of each neighbor, the last one is 1 and the missing ones are 2
+   int Choose(double u) const {return (cumprob[0]<u) + (cumprob[1]<u) + (cumprob[2]<u) + (cumprob[3]<u);}
+      // the neighbor for a uniform draw u in [0,1[, the first one whose cumulative probability is not below u,
+      // counted without branches as the cumulative probabilities do not decrease
+};
+
+// TWalker: a random walk that runs in lockstep with others (see TLandscape::Walk)
+
+struct TWalker
+{
+   int x;      // current cell
+   int y;
+   int id;     // number of the walk in its batch
+   bool dead;  // whether the walk ended without a cell in the last step
+};
+
+class TWalkIndex
+{
+ public:
+   TWalkIndex();
+   void Build(const TRaster* land, double sinkavoidance, double neighavoidance);
+   void Occupy(int x, int y);   // a free cell was occupied
+   void Free(int x, int y);     // an occupied cell was freed
+   const TWalkStep& Step(int x, int y) const {return steps[code[long(x)*ymax + y]];}
+   void Track();                // starts marking the cells whose code changes
+   void Untrack();              // stops marking and clears the marks
+   bool Changed(int x, int y) const {return changed[long(x)*ymax + y]!=0;}
+ private:
+   void Change(int x, int y, int delta);
+
+   int xmax;
+   int ymax;
+   vector<TWalkStep> steps;     // transitions of each code
+   vector<uint16_t> code;       // code of each cell, row by row: twice the state of its neighborhood, plus 1 if it is sink
+   bool tracking;
+   vector<uint8_t> changed;     // whether the code of each cell changed while tracking, only allocated when tracking
+   vector<long> marked;         // cells marked in changed
+};
+
+#endif
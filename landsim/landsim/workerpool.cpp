@@ -0,0 +1,74 @@
+#include "workerpool.h"
+
+
+// Constructor of TWorkerPool: creates a pool without workers, which are started by the first Run that needs them
+
+TWorkerPool::TWorkerPool() : job(NULL), njobs(0), pending(0), generation(0), stop(false)
+{
+}
+
+
+// Destructor of TWorkerPool: wakes the workers to end and joins them
+
+TWorkerPool::~TWorkerPool()
+{
+ {
+ unique_lock<mutex> l(lock);
+ stop = true;
+ }
+ wake.notify_all();
+ for (unsigned int t=0; t<workers.size(); t++)
+   workers[t].join();
+}
+
+
+// Run: runs job(t) for t from 0 to n-1, job(0) in the calling thread and the others in the workers, starting the
+// workers that are missing. Returns when all the jobs have finished.
+
+void TWorkerPool::Run(int n, const function<void(int)>& jobIn)
+{
+ while (int(workers.size()) < n-1)   // the workers only wait for batches after this one
+   workers.push_back(thread(&TWorkerPool::Work, this, int(workers.size())+1, generation));
+ if (n > 1)
+   {
+   unique_lock<mutex> l(lock);
+   job = &jobIn;
+   njobs = n;
+   pending = n-1;
+   generation++;
+   }
+ wake.notify_all();
+ if (n > 0)
+   jobIn(0);
+ if (n > 1)
+   {
+   unique_lock<mutex> l(lock);
+   while (pending > 0)
+     done.wait(l);
+   }
+}
+
+
+// Work: the loop of worker t, which runs job(t) of every batch that has that many jobs
+// seen is the last batch that the worker already knows of.
+
+void TWorkerPool::Work(int t, long seen)
+{
+ unique_lock<mutex> l(lock);
+ while (true)
+   {
+   while (!stop && generation==seen)
+     wake.wait(l);
+   if (stop)
+     return;
+   seen = generation;
+   if (t >= njobs)     // this batch has fewer jobs than workers
+     continue;
+   const function<void(int)>* f = job;
+   l.unlock();
+   (*f)(t);
+   l.lock();
+   if (--pending == 0)
+     done.notify_one();
+   }
+}
@@ -0,0 +1,40 @@
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// TWorkerPool: threads that are started once and then run the jobs of each batch of the settlement in two phases
+// (see TLandscape::Speculate), instead of starting and joining new threads for every batch
+// Run(n, job) runs job(0) in the calling thread and job(1) to job(n-1) in the workers, and returns when all of
+// them have finished. The workers sleep between batches and are joined when the pool is destroyed.
+
+class TWorkerPool
+{
+ public:
+   TWorkerPool();
+   ~TWorkerPool();
+   void Run(int n, const function<void(int)>& job);
+   int Size() const {return int(workers.size());}
+ private:
+   TWorkerPool(const TWorkerPool&);
+   TWorkerPool& operator=(const TWorkerPool&);
+   void Work(int t, long seen);
+
+   vector<thread> workers;   // worker t-1 runs job(t)
+   mutex lock;
+   condition_variable wake;  // a new batch or the end of the pool
+   condition_variable done;  // the last job of the batch has finished
+   const function<void(int)>* job;
+   int njobs;
+   int pending;              // jobs of the workers that have not finished
+   long generation;          // number of batches run so far
+   bool stop;
+};
+
+#endif